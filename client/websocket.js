@@ -70,6 +70,10 @@ export class Client {
         /*Error/warning from server */
         this.error('Server ' + msg);  
       }
+      else if (type === 't') {
+        /* Analysis of the server engine (score, best line) */
+        this.displayGreen(msg.substring(1));
+      }
       else if (type === 'f') {
         let fen = msg.substring(1);
         console.log('restarting with FEN ' + fen); 
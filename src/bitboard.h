@@ -0,0 +1,241 @@
+#include "common.h"
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  A "Bitboard" is a set of squares packed into a 64 bit ..
+  .. unsigned int. The bit 's' corresponds to the square ..
+  .. 's' with the same numbering as _Board.pieces[] ..
+  .. (0 : a8, 7 : h8, 56 : a1, 63 : h1).
+  Queries like "all the white knights" or "all occupied ..
+  .. squares" are a single Bitboard, and iterating through ..
+  .. a set is a loop over its set bits.
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef uint64_t Bitboard;
+
+#define BITBOARD(s)       (((Bitboard) 1) << (s))
+#define BITBOARD_HAS(B,s) (((B) >> (s)) & 1)
+
+//Number of squares in the set
+static inline int BitboardCount(Bitboard b) {
+  return __builtin_popcountll(b);
+}
+
+//Least significant square of a non-empty set
+static inline int BitboardFirst(Bitboard b) {
+  assert(b);
+  return __builtin_ctzll(b);
+}
+
+//Remove and return the least significant square of the set
+static inline int BitboardPop(Bitboard * b) {
+  int s = BitboardFirst(*b);
+  *b &= *b - 1;
+  return s;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Precomputed attack tables. Call BitboardInit() once ..
+  .. (done inside BoardInitIterator()) before using them.
+  Leapers (pawn, knight, king) : a single lookup
+    KNIGHT_ATTACKS[s], KING_ATTACKS[s], PAWN_ATTACKS[color][s]
+  Sliders (rook, bishop, queen) : attacks depend on the ..
+  .. occupancy "occ" along the rays. The relevant bits of ..
+  .. "occ" (i.e the ray squares excluding the board edges) ..
+  .. are hashed to an index of a table, either with a ..
+  .. "magic" multiplication or with PEXT instruction if ..
+  .. compiled for BMI2 (-mbmi2). 
+    BitboardRookAttacks(s, occ), BitboardBishopAttacks(s, occ)
+  Refer to
+    https://www.chessprogramming.org/Magic_Bitboards
+------------------------------------------------------------
+--------------------------------------------------------- */
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+Bitboard KNIGHT_ATTACKS[64], KING_ATTACKS[64], PAWN_ATTACKS[2][64];
+
+/* For two squares s1, s2 aligned along a rank, file or a ..
+.. diagonal, BETWEEN[s1][s2] is the set of squares strictly ..
+.. in between them and LINE[s1][s2] is the entire line ..
+.. (edge to edge) passing through them. Otherwise both are 0 */
+Bitboard BETWEEN[64][64], LINE[64][64];
+
+typedef struct {
+  Bitboard mask;      // relevant occupancy 
+  Bitboard magic;     // magic multiplier (unused with PEXT)
+  Bitboard * attacks; // attack sets indexed by occupancy
+  int shift;          // 64 - (bits in mask)
+} _BitboardMagic;
+
+_BitboardMagic ROOK_MAGICS[64], BISHOP_MAGICS[64];
+
+//Total entries : 102400 for rooks and 5248 for bishops
+Bitboard SLIDER_ATTACKS[102400 + 5248];
+
+static inline 
+unsigned BitboardMagicIndex(const _BitboardMagic * m, Bitboard occ) {
+#ifdef __BMI2__
+  return (unsigned) _pext_u64(occ, m->mask);
+#else
+  return (unsigned) (((occ & m->mask) * m->magic) >> m->shift);
+#endif
+}
+
+static inline Bitboard BitboardRookAttacks(int s, Bitboard occ) {
+  const _BitboardMagic * m = &ROOK_MAGICS[s];
+  return m->attacks[BitboardMagicIndex(m, occ)];
+}
+
+static inline Bitboard BitboardBishopAttacks(int s, Bitboard occ) {
+  const _BitboardMagic * m = &BISHOP_MAGICS[s];
+  return m->attacks[BitboardMagicIndex(m, occ)];
+}
+
+static inline Bitboard BitboardQueenAttacks(int s, Bitboard occ) {
+  return BitboardRookAttacks(s, occ) | BitboardBishopAttacks(s, occ);
+}
+
+/* (rank, file) steps of each ray. rank 0 is the 8th rank */
+static const int BITBOARD_ROOK_RAYS[4][2] = 
+  { {1,0}, {0,1}, {-1,0}, {0,-1} };
+static const int BITBOARD_BISHOP_RAYS[4][2] = 
+  { {1,1}, {-1,1}, {-1,-1}, {1,-1} };
+
+//Slow attack set, walking each ray. Used only for the init
+static Bitboard BitboardRayAttacks(int s, const int rays[4][2],
+    Bitboard occ) {
+  Bitboard attacks = 0;
+  for(int i=0; i<4; ++i) {
+    int r = s/8 + rays[i][0], f = s%8 + rays[i][1];
+    for(; r>=0 && r<8 && f>=0 && f<8; 
+        r += rays[i][0], f += rays[i][1]) {
+      attacks |= BITBOARD(8*r + f);
+      if(BITBOARD_HAS(occ, 8*r + f))
+        break;  //blocked
+    }
+  }
+  return attacks;
+}
+
+//Attack sets of a leaper with (rank, file) jumps
+static Bitboard BitboardJumpAttacks(int s, const int jumps[][2],
+    int njumps) {
+  Bitboard attacks = 0;
+  for(int i=0; i<njumps; ++i) {
+    int r = s/8 + jumps[i][0], f = s%8 + jumps[i][1];
+    if(r>=0 && r<8 && f>=0 && f<8)
+      attacks |= BITBOARD(8*r + f);
+  }
+  return attacks;
+}
+
+//xorshift64. Fixed seed, so that magics (and zobrist keys ..
+// .. of board.h) are reproducible
+static Bitboard BitboardRandom(Bitboard * seed) {
+  *seed ^= *seed >> 12; 
+  *seed ^= *seed << 25; 
+  *seed ^= *seed >> 27;
+  return *seed * 2685821657736338717ULL;
+}
+
+static Bitboard * BitboardInitMagics(_BitboardMagic magics[64],
+    const int rays[4][2], Bitboard * table) {
+  Bitboard occupancy[4096], reference[4096];
+#ifndef __BMI2__
+  int epoch[4096] = {0}, attempt = 0;
+  Bitboard seed = 0x9E3779B97F4A7C15ULL;
+#endif
+  for(int s=0; s<64; ++s) {
+    _BitboardMagic * m = &magics[s];
+    //Board edges are irrelevant, unless the piece is on it
+    Bitboard edges = 
+      ((0xFFULL | (0xFFULL << 56)) & ~(0xFFULL << (8*(s/8)))) |
+      ((0x0101010101010101ULL | (0x8080808080808080ULL)) & 
+        ~(0x0101010101010101ULL << (s%8)));
+    m->mask = BitboardRayAttacks(s, rays, 0) & ~edges;
+    m->shift = 64 - BitboardCount(m->mask);
+    m->attacks = table;
+
+    //Enumerate all subsets of the mask (Carry-Rippler)
+    int n = 0;
+    Bitboard sub = 0;
+    do {
+      occupancy[n] = sub;
+      reference[n++] = BitboardRayAttacks(s, rays, sub);
+      sub = (sub - m->mask) & m->mask;
+    } while(sub);
+
+#ifdef __BMI2__
+    m->magic = 0;
+    for(int i=0; i<n; ++i)
+      m->attacks[BitboardMagicIndex(m, occupancy[i])] = reference[i];
+#else
+    //Trial and error till there is no destructive collision
+    for(int i=0; i<n; ) {
+      do 
+        m->magic = BitboardRandom(&seed) & BitboardRandom(&seed) &
+          BitboardRandom(&seed);
+      while(BitboardCount((m->magic * m->mask) >> 56) < 6);
+      ++attempt;
+      for(i=0; i<n; ++i) {
+        unsigned idx = BitboardMagicIndex(m, occupancy[i]);
+        if(epoch[idx] < attempt) {
+          epoch[idx] = attempt;
+          m->attacks[idx] = reference[i];
+        }
+        else if(m->attacks[idx] != reference[i])
+          break; //collision. try another magic
+      }
+    }
+#endif
+    table += n;
+  }
+  return table;
+}
+
+void BitboardInit() {
+  static const int KNIGHT_JUMPS[8][2] = {
+    {2,1}, {1,2}, {1,-2}, {2,-1},
+    {-2,-1}, {-1,-2}, {-1,2}, {-2,1} };
+  static const int KING_JUMPS[8][2] = {
+    {1,0}, {1,1}, {0,1}, {-1,1},
+    {-1,0}, {-1,-1}, {0,-1}, {1,-1} };
+  // Pawn captures. White (index 1) moves to lower ranks
+  static const int PAWN_JUMPS[2][2][2] = {
+    { {1,-1}, {1,1} }, { {-1,-1}, {-1,1} } };
+
+  for(int s=0; s<64; ++s) {
+    KNIGHT_ATTACKS[s] = BitboardJumpAttacks(s, KNIGHT_JUMPS, 8);
+    KING_ATTACKS[s]   = BitboardJumpAttacks(s, KING_JUMPS, 8);
+    for(int c=0; c<2; ++c)
+      PAWN_ATTACKS[c][s] = BitboardJumpAttacks(s, PAWN_JUMPS[c], 2);
+  }
+
+  Bitboard * table = SLIDER_ATTACKS;
+  table = BitboardInitMagics(ROOK_MAGICS, BITBOARD_ROOK_RAYS, table);
+  table = BitboardInitMagics(BISHOP_MAGICS, BITBOARD_BISHOP_RAYS, table);
+  assert(table == SLIDER_ATTACKS + 102400 + 5248);
+
+  for(int s1=0; s1<64; ++s1)
+    for(int s2=0; s2<64; ++s2) {
+      BETWEEN[s1][s2] = LINE[s1][s2] = 0;
+      if(s1 == s2)
+        continue;
+      Bitboard ends = BITBOARD(s1) | BITBOARD(s2);
+      if(BITBOARD_HAS(BitboardRookAttacks(s1, 0), s2)) {
+        LINE[s1][s2] = ends | 
+          (BitboardRookAttacks(s1, 0) & BitboardRookAttacks(s2, 0));
+        BETWEEN[s1][s2] = BitboardRookAttacks(s1, BITBOARD(s2)) &
+          BitboardRookAttacks(s2, BITBOARD(s1));
+      }
+      else if(BITBOARD_HAS(BitboardBishopAttacks(s1, 0), s2)) {
+        LINE[s1][s2] = ends | 
+          (BitboardBishopAttacks(s1, 0) & BitboardBishopAttacks(s2, 0));
+        BETWEEN[s1][s2] = BitboardBishopAttacks(s1, BITBOARD(s2)) &
+          BitboardBishopAttacks(s2, BITBOARD(s1));
+      }
+    }
+}
@@ -1,5 +1,5 @@
 
-#include "common.h"
+#include "bitboard.h"
 
 #define NOT_UNUSED(x) (void)(x)
 
@@ -61,18 +61,20 @@ static inline Piece PieceParse(char p) {
     return EMPTY;
   return piece; // valid piece
 }
-//Squares [-2:9]x[-2:9] with [0:7]x[0:7] is inside
+//Squares [-2:9]x[-2:9] with [0:7]x[0:7] is inside. ..
+// .. Read only once initialized (BoardInitIterator()), so ..
+// .. it can be shared by any number of boards and threads.
 Square ** GAMEBOARD = NULL; 
-Piece * PIECES = NULL;    //store pieces/empty square
 //Below: A square "S" is a pointer whose content is in [0,64]
+// .. and "B" is the board (_Board *) whose piece is looked up
 #define IS_OUTSIDE(S)   ((*S) == OUTSIDE)
-#define SQUARE_PIECE(S) (IS_OUTSIDE(S) ? 16 : PIECES[*S])
-#define PIECE_COLOR(S)  (SQUARE_PIECE(S) & 1)
+#define SQUARE_PIECE(B,S) (IS_OUTSIDE(S) ? 16 : (B)->pieces[*S])
+#define PIECE_COLOR(B,S)  (SQUARE_PIECE(B,S) & 1)
 #define SQUARE_FILE(S)  ('a' + (*S)%8)
 #define SQUARE_RANK(S)  ('0' + 8 - (*S)/8)
-#define PIECE_ASCII(S)  (MAPPING[SQUARE_PIECE(S)])
-#define IS_EMPTY(S)     (SQUARE_PIECE(S) == EMPTY)
-#define IS_PIECE(S)     (!IS_OUTSIDE(S) && !IS_EMPTY(S))
+#define PIECE_ASCII(B,S)  (MAPPING[SQUARE_PIECE(B,S)])
+#define IS_EMPTY(B,S)     (SQUARE_PIECE(B,S) == EMPTY)
+#define IS_PIECE(B,S)     (!IS_OUTSIDE(S) && !IS_EMPTY(B,S))
 static inline Square * SquarePointer(Square s) {
   //assert(s<=OUTSIDE);
   return &(GAMEBOARD[s/8][s%8]);
@@ -92,6 +94,10 @@ static inline Square * SquarePointer(Square s) {
 typedef struct {
   //64 pieces corresponding to each square on GAMEBOARD[][]
   Piece pieces[64];
+  //Set of squares occupied by each piece (bitboard[WPAWN], ..)
+  // .. bitboard[BLACK] and bitboard[WHITE] are not used by any ..
+  // .. piece, so they store the occupancy of each color.
+  Bitboard bitboard[14];
   /** -----------Game Status Metadata--------------*/
   //squares to store WKING, BKING, ENPASS \in [0,63)
   Square king[2], enpassante;
@@ -103,15 +109,116 @@ typedef struct {
   Flag color;
   //Game Status; 
   Flag status; 
+  //Zobrist key of the position (refer BoardHash())
+  uint64_t hash;
 }_Board;
 
 void BoardCopy(_Board * b, _Board * source){
   memcpy (b, source, sizeof(_Board));
 }
 
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Zobrist hashing. A random key is assigned to each ..
+  .. (piece, square), each castling availability (16 ..
+  .. combinations), each en-passante file and the turn ..
+  .. (white to move). The hash of a position is the XOR ..
+  .. of the keys present in it
+    b->hash = BoardHash(b);
+  Since XOR is its own inverse, "b->hash" is updated ..
+  .. incrementally when a piece is set/cleared from a ..
+  .. square and when the metadata changes (refer ..
+  .. BoardUpdateMetadata()). Refer
+    https://www.chessprogramming.org/Zobrist_Hashing
+------------------------------------------------------------
+--------------------------------------------------------- */
+uint64_t ZOBRIST_PIECES[14][64], ZOBRIST_CASTLING[16],
+  ZOBRIST_ENPASSANTE[8], ZOBRIST_COLOR;
+
+//castling flags (MOVE_kCASTLE, .. MOVE_QCASTLE) are 8, .., 64
+#define ZOBRIST_CASTLE(castling) ZOBRIST_CASTLING[(castling) >> 3]
+
+void BoardZobristInit() {
+  Bitboard seed = 0x2545F4914F6CDD1DULL;
+  for(int p=0; p<14; ++p)
+    for(int s=0; s<64; ++s)
+      //No keys for EMPTY, BLACK or WHITE
+      ZOBRIST_PIECES[p][s] = p < 2 ? 0 : BitboardRandom(&seed);
+  for(int c=0; c<16; ++c)
+    ZOBRIST_CASTLING[c] = c ? BitboardRandom(&seed) : 0;
+  for(int f=0; f<8; ++f)
+    ZOBRIST_ENPASSANTE[f] = BitboardRandom(&seed);
+  ZOBRIST_COLOR = BitboardRandom(&seed);
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Every change to the piece on a square should go through
+    BoardSquareSet(b, s, piece);  //'s' has to be empty
+    BoardSquareClear(b, s);       //'s' has to be occupied
+  .. so that the mailbox "b->pieces[]" and the bitboards ..
+  .. "b->bitboard[]" (and "b->hash") are always in sync.
+------------------------------------------------------------
+--------------------------------------------------------- */
+static inline void BoardSquareSet(_Board * b, Square s, Piece p) {
+  assert(b->pieces[s] == EMPTY && p != EMPTY);
+  Bitboard sq = BITBOARD(s);
+  b->pieces[s] = p;
+  b->bitboard[p] |= sq;
+  b->bitboard[p & 1] |= sq;
+  b->hash ^= ZOBRIST_PIECES[p][s];
+}
+
+static inline void BoardSquareClear(_Board * b, Square s) {
+  Piece p = b->pieces[s];
+  assert(p != EMPTY);
+  Bitboard sq = ~BITBOARD(s);
+  b->pieces[s] = EMPTY;
+  b->bitboard[p] &= sq;
+  b->bitboard[p & 1] &= sq;
+  b->hash ^= ZOBRIST_PIECES[p][s];
+}
+
+//Occupancy of both colors
+static inline Bitboard BoardOccupancy(_Board * b) {
+  return b->bitboard[WHITE] | b->bitboard[BLACK];
+}
+
+//Zobrist key of the en-passante square (if any)
+static inline uint64_t BoardHashEnpassante(_Board * b) {
+  return b->enpassante < OUTSIDE ? 
+    ZOBRIST_ENPASSANTE[b->enpassante % 8] : 0;
+}
+
+//Hash of the board computed from scratch
+uint64_t BoardHash(_Board * b) {
+  uint64_t hash = ZOBRIST_CASTLE(b->castling) ^ 
+    BoardHashEnpassante(b) ^ (b->color ? ZOBRIST_COLOR : 0);
+  for(Square s=0; s<64; ++s)
+    hash ^= ZOBRIST_PIECES[b->pieces[s]][s];
+  return hash;
+}
+
+//Rebuild all bitboards from the mailbox "b->pieces[]"
+void BoardSetBitboards(_Board * b) {
+  memset(b->bitboard, 0, sizeof(b->bitboard));
+  for(Square s=0; s<64; ++s) {
+    Piece p = b->pieces[s];
+    if(p == EMPTY)
+      continue;
+    b->bitboard[p] |= BITBOARD(s);
+    b->bitboard[p & 1] |= BITBOARD(s);
+  }
+}
+
 void BoardInitIterator(){
   if(GAMEBOARD) 
     return;
+
+  // Attack tables of each piece (refer bitboard.h)
+  BitboardInit();
+  // Keys for hashing the board
+  BoardZobristInit();
     
   // Allocate mem for 2-D GAMEBOARD (8x8) with ..
   // .. 2 layer padding on each sides (12x12).
@@ -136,12 +243,6 @@ void BoardInitIterator(){
   GAMEBOARD = squareBoard;
 }
 
-Square ** BoardMakeAvailable(_Board * b){
-  PIECES = b->pieces; 
-  assert(GAMEBOARD);
-  return GAMEBOARD; 
-}
-
 Flag BoardSetFromFEN(_Board * b, char * fen){
   b->npieces = 0; 
   b->king[WHITE] = OUTSIDE; 
@@ -205,6 +306,7 @@ Flag BoardSetFromFEN(_Board * b, char * fen){
   for(Flag c=0; c<2; ++c)
     if(b->king[c] == OUTSIDE)
       return 0;
+  BoardSetBitboards(b);
 
   //Let's see whose turn is now ('w'/'b')
   b->color = (*fen == 'w') ? WHITE : BLACK;
@@ -271,6 +373,7 @@ Flag BoardSetFromFEN(_Board * b, char * fen){
   if(*fen != '\0')
     return 0;
 
+  b->hash = BoardHash(b);
   return 1; // succesful
 }
 
@@ -349,7 +452,8 @@ _Board * Board(_Board * source) {
   .. GAMEBOARD is more like an iterator. It's global for ..
   .. any game, and help through each ..
   .. square ( = GAMEBOARD[r][c])  of the board ..
-  .. and can be used to find the piece = (PIECES[square]) */
+  .. and can be used to find the piece = ..
+  .. (board->pieces[*square]) */
   if(!GAMEBOARD)
     BoardInitIterator();
      
@@ -384,21 +488,21 @@ void BoardPrint(_Board * board){
 /*------------------------------------------------------------
 conditions to check while moving piece from 'FROM' to 'TO'
 --------------------------------------------------------- */
-#define IS_NORMAL(FROM,TO)  ( IS_EMPTY(TO) )
-#define IS_BLOCKED(FROM,TO) ( IS_PIECE(TO) && \
-  (PIECE_COLOR(FROM) == PIECE_COLOR(TO)) )
-#define IS_CAPTURE(FROM,TO) ( IS_PIECE(TO) && \
-  (PIECE_COLOR(FROM) != PIECE_COLOR(TO)) )
-#define IS_PROMOTION(FROM,TO)\
-  ( (( SQUARE_PIECE(FROM) == WPAWN) && \
+#define IS_NORMAL(B,FROM,TO)  ( IS_EMPTY(B,TO) )
+#define IS_BLOCKED(B,FROM,TO) ( IS_PIECE(B,TO) && \
+  (PIECE_COLOR(B,FROM) == PIECE_COLOR(B,TO)) )
+#define IS_CAPTURE(B,FROM,TO) ( IS_PIECE(B,TO) && \
+  (PIECE_COLOR(B,FROM) != PIECE_COLOR(B,TO)) )
+#define IS_PROMOTION(B,FROM,TO)\
+  ( (( SQUARE_PIECE(B,FROM) == WPAWN) && \
      (SQUARE_RANK(TO) == '8')) || \
-    (( SQUARE_PIECE(FROM) == BPAWN) && \
+    (( SQUARE_PIECE(B,FROM) == BPAWN) && \
      (SQUARE_RANK(TO) == '1')) )
-#define IS_ENPASSANTE(FROM,TO,BOARD) \
-  ( (SQUARE_PIECE(FROM) == WPAWN && SQUARE_RANK(FROM) == '5' \
-      && (*TO) == (BOARD)->enpassante ) ||\
-    (SQUARE_PIECE(FROM) == BPAWN && SQUARE_RANK(FROM) == '4' \
-      && (*TO) == (BOARD)->enpassante ) )
+#define IS_ENPASSANTE(B,FROM,TO) \
+  ( (SQUARE_PIECE(B,FROM) == WPAWN && SQUARE_RANK(FROM) == '5' \
+      && (*TO) == (B)->enpassante ) ||\
+    (SQUARE_PIECE(B,FROM) == BPAWN && SQUARE_RANK(FROM) == '4' \
+      && (*TO) == (B)->enpassante ) )
 /*
 const char QUEEN_MOVES[8][2] = {
   {1,0}, {1,1}, {0,1}, {-1,1},
@@ -455,6 +559,75 @@ Flag BoardMoveCompare(_BoardMove * m, _BoardMove * M) {
   return 1;
 }
 
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  A "Move" is the compact (16 bit) form of a _BoardMove,
+    bits [0:6) : from square, bits [6:12) : to square,
+    bits [12:16) : special (MOVE_SPECIAL_*)
+  .. used wherever moves are stored in bulk (move lists, ..
+  .. tree nodes, game history, hash tables). The pieces ..
+  .. and flags of a _BoardMove can be recovered from the ..
+  .. board on which the move is played
+    BoardMoveDecode(b, m, &move);
+  .. and the other way around
+    Move m = BoardMoveEncode(&move);
+  NOTE: MOVE_CHECK is not encoded. 
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef uint16_t Move;
+
+#define MOVE_NONE 0  //from a8 to a8 : never a valid move
+
+#define MOVE_SPECIAL_NORMAL     0  //quiet moves and captures
+#define MOVE_SPECIAL_ENPASSANTE 1
+#define MOVE_SPECIAL_CASTLE     2
+//Promotion to rook, knight, bishop, queen is 4, 5, 6, 7
+#define MOVE_SPECIAL_PROMOTION  4
+
+#define MOVE_PACK(FROM,TO,SPECIAL) \
+  ((Move) ((FROM) | ((TO) << 6) | ((SPECIAL) << 12)))
+#define MOVE_FROM(M)       ((Square) ((M) & 63))
+#define MOVE_TO(M)         ((Square) (((M) >> 6) & 63))
+#define MOVE_SPECIAL(M)    ((Flag) ((M) >> 12))
+#define MOVE_IS_PROMOTION(M) \
+  (MOVE_SPECIAL(M) >= MOVE_SPECIAL_PROMOTION)
+//special for promotion to 'piece' & vice versa (black piece)
+#define MOVE_SPECIAL_PROMOTED(PIECE) \
+  ((Flag) (2 + ((PIECE) >> PIECE_SHIFT)))
+#define MOVE_PROMOTED(M) \
+  ((Piece) ((MOVE_SPECIAL(M) - 2) << PIECE_SHIFT))
+
+Move BoardMoveEncode(_BoardMove * move) {
+  Flag special = 
+    (move->flags & MOVE_ENPASSANTE) ? MOVE_SPECIAL_ENPASSANTE :
+    (move->flags & (MOVE_kCASTLE | MOVE_KCASTLE | 
+      MOVE_qCASTLE | MOVE_QCASTLE)) ? MOVE_SPECIAL_CASTLE :
+    (move->flags & MOVE_PROMOTION) ? 
+      MOVE_SPECIAL_PROMOTED(move->promotion) : MOVE_SPECIAL_NORMAL;
+  return MOVE_PACK(move->from.square, move->to.square, special);
+}
+
+void BoardMoveDecode(_Board * b, Move m, _BoardMove * move) {
+  Square from = MOVE_FROM(m), to = MOVE_TO(m);
+  Flag special = MOVE_SPECIAL(m);
+  Piece piece = b->pieces[from];
+  move->from.piece = piece;
+  move->from.square = from;
+  move->to.piece = b->pieces[to];
+  move->to.square = to;
+  move->promotion = EMPTY;
+  move->flags = move->to.piece == EMPTY ? MOVE_NORMAL : MOVE_CAPTURE;
+  if(special == MOVE_SPECIAL_ENPASSANTE)
+    move->flags = MOVE_ENPASSANTE | MOVE_CAPTURE;
+  else if(special == MOVE_SPECIAL_CASTLE) 
+    move->flags = (to > from ? MOVE_kCASTLE : MOVE_qCASTLE) 
+      << (piece & 1);
+  else if(special >= MOVE_SPECIAL_PROMOTION) {
+    move->flags |= MOVE_PROMOTION;
+    move->promotion = MOVE_PROMOTED(m) | (piece & 1);
+  }
+}
+
 char* BoardMoveSAN (_BoardMove * m) {
   //fixme: Not et impelemented 
   assert(0);
@@ -508,40 +681,42 @@ void BoardMove(_Board * b, _BoardMove * move){
   
   assert(pieces[from] == move->from.piece);
   
-  pieces[from] = EMPTY;
-  pieces[to]   = (move->flags & MOVE_PROMOTION) ? 
-    move->promotion : move->from.piece;
+  BoardSquareClear(b, from);
+  if(pieces[to] != EMPTY)
+    BoardSquareClear(b, to);
+  BoardSquareSet(b, to, (move->flags & MOVE_PROMOTION) ? 
+    move->promotion : move->from.piece);
 
   if(pieces[to] == WKING) {
     b->king[WHITE] = to;
     if(move->flags & MOVE_QCASTLE) {
-      pieces[56] = EMPTY;
-      pieces[59] = WROOK;
+      BoardSquareClear(b, 56);
+      BoardSquareSet(b, 59, WROOK);
       return;
     }
     if(move->flags & MOVE_KCASTLE) {
-      pieces[63] = EMPTY;
-      pieces[61] = WROOK;
+      BoardSquareClear(b, 63);
+      BoardSquareSet(b, 61, WROOK);
       return;
     }
   }
   else if(pieces[to] == BKING) {
     b->king[BLACK] = to;
     if(move->flags & MOVE_qCASTLE) {
-      pieces[0] = EMPTY;
-      pieces[3] = BROOK;
+      BoardSquareClear(b, 0);
+      BoardSquareSet(b, 3, BROOK);
       return;
     }
     if(move->flags & MOVE_kCASTLE) {
-      pieces[7] = EMPTY;
-      pieces[5] = BROOK;
+      BoardSquareClear(b, 7);
+      BoardSquareSet(b, 5, BROOK);
       return;
     }
   }
 
   if(move->flags & MOVE_ENPASSANTE) { 
     //assert(b->enpassante == to);
-    pieces[to + (b->color ? 8 : -8)] = EMPTY;
+    BoardSquareClear(b, to + (b->color ? 8 : -8));
   }
   
 } 
@@ -555,39 +730,41 @@ void BoardUnmove(_Board * b, _BoardMove * move){
     to = move->to.square;
   Piece * pieces = b->pieces;
 
-  pieces[from] = move->from.piece;
-  pieces[to]   = move->to.piece;
+  BoardSquareClear(b, to);
+  BoardSquareSet(b, from, move->from.piece);
+  if(move->to.piece != EMPTY)
+    BoardSquareSet(b, to, move->to.piece);
 
   if(pieces[from] == WKING) {
     b->king[WHITE] = from;
     if(move->flags & MOVE_QCASTLE) {
-      pieces[56] = WROOK;
-      pieces[59] = EMPTY;
+      BoardSquareClear(b, 59);
+      BoardSquareSet(b, 56, WROOK);
       return;
     }
     if(move->flags & MOVE_KCASTLE) {
-      pieces[63] = WROOK;
-      pieces[61] = EMPTY;
+      BoardSquareClear(b, 61);
+      BoardSquareSet(b, 63, WROOK);
       return;
     }
   }
   else if(pieces[from] == BKING) {
     b->king[BLACK] = from;
     if(move->flags & MOVE_qCASTLE) {
-      pieces[0] = BROOK;
-      pieces[3] = EMPTY;
+      BoardSquareClear(b, 3);
+      BoardSquareSet(b, 0, BROOK);
       return;
     }
     if(move->flags & MOVE_kCASTLE) {
-      pieces[7] = BROOK;
-      pieces[5] = EMPTY;
+      BoardSquareClear(b, 5);
+      BoardSquareSet(b, 7, BROOK);
       return;
     }
   }
    
   if(move->flags & MOVE_ENPASSANTE) {
     //assert(b->enpassante == to); 
-    pieces[to + (b->color ? 8 : -8)]
-      = b->color ? BPAWN : WPAWN;
+    BoardSquareSet(b, to + (b->color ? 8 : -8),
+      b->color ? BPAWN : WPAWN);
   }
-} 
+}
@@ -3,7 +3,13 @@
 ToDo: Naive eval function. MiniMax. a-b pruning.
 */
 
-#include "tree.h"
+#include "hashtable.h"
+#include <pthread.h>
+
+//Longest line searched by the engine
+#ifndef ENGINE_MAX_PLY
+#define ENGINE_MAX_PLY 128
+#endif
 
 typedef struct _Engine{
   //which color is this Engine representing;
@@ -11,12 +17,44 @@ typedef struct _Engine{
   //Tree from which you deduce the 'best' moves
   _Tree * tree;
   //fn pointer to update the tree when opponent makes move
-  Flag (* update_tree) (struct _Engine * e, _BoardMove * move);
+  Flag (* update_tree) (struct _Engine * e, Move move);
   //By default the tree is also updated.
   Flag (*engine) (struct _Engine * e);
+  //Budget of a search : max depth (in plies), time (in ..
+  // .. seconds) and number of nodes (0 : no limit).
+  int depth;
+  double time;
+  size_t maxnodes;
+  //Number of search threads (Lazy SMP, refer EngineSearch())
+  int nthreads;
+  //Selective search : null move pruning and late move ..
+  // .. reductions (refer EngineAlphaBeta()) can be switched off
+  Flag nullmove, lmr;
+  //Score, depth completed and number of nodes visited ..
+  // .. (by all the threads) in the last search. 
+  int score, depthdone;
+  size_t nodes;
+  //Principal variation (expected line of play) of the ..
+  // .. last search. pv[0] is the move played
+  Move pv[ENGINE_MAX_PLY + 1];
+  int pvlen;
+  //Search stops once "stop" is set (budget is exhausted). ..
+  // .. Shared by the threads, so accessed atomically
+  Flag stop;
+  double deadline;
+  //Transposition table (refer hashtable.h)
+  _HashTable * table;
+  //Pondering (refer EnginePonder()). "pondering" is set ..
+  // .. till a ponder hit, and accessed atomically.
+  Flag ponder, ponderstate, pondering;
+  Move pondermove, ponderbest;
+  _Board ponderboard;
+  pthread_t ponderthread;
 }_Engine;
 
-Flag EngineUpdateTree(_Engine * e, _BoardMove * m){
+Flag EngineUpdateTree(_Engine * e, Move m){
+  //Tree may still be growing in the background
+  TreeWait();
   _Tree * root = e->tree;
 
   //if(!root)
@@ -36,7 +74,7 @@ Flag EngineUpdateTree(_Engine * e, _BoardMove * m){
 
     //if(!child)
     //  return 0;
-    if(BoardMoveCompare(m, &child->move)) {
+    if(m == child->move) {
 
       _Tree * next = TreeNext(e->tree, i);
       if(!next)
@@ -162,67 +200,876 @@ int NnueEvaluate(_Board * b) {
 }
 #endif
 
-/*
-NegaMax pseudo algo
-int negaMax( int depth ) {
-    if ( depth == 0 ) return evaluate();
-    int max = -oo;
-    for ( all moves)  {
-        score = -negaMax( depth - 1 );
-        if( score > max )
-            max = score;
-    }
-    return max;
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Alpha-beta search (fail-soft negamax)
+    score = EngineAlphaBeta(t, b, depth, ply, alpha, beta);
+  Children are generated on the fly and played on the ..
+  .. same board "b" with BoardMakeMove()/BoardUndoMove(), ..
+  .. so the memory used is O(depth) (a MoveList per ply), ..
+  .. unlike the full width _Tree. Leaves (depth 0) are ..
+  .. resolved by a quiescence search (EngineQuiescence()). ..
+  .. Lines that are unlikely to matter are searched to a ..
+  .. lesser depth (null move pruning, late move reductions).
+  Scores are from the point of view of the player to ..
+  .. move. Being mated at "ply" plies from the root scores ..
+  .. -ENGINE_MATE + ply (so that faster mates are ..
+  .. preferred), a draw scores 0, and the evaluations of ..
+  .. NnueEvaluate() are clamped below any mate score.
+  Refer
+    https://www.chessprogramming.org/Alpha-Beta
+------------------------------------------------------------
+--------------------------------------------------------- */
+#define ENGINE_MATE     ENGINE_EVAL_MAX
+#define ENGINE_INFINITY (ENGINE_EVAL_MAX + 1)
+#ifndef ENGINE_SEARCH_DEPTH
+#define ENGINE_SEARCH_DEPTH 64
+#endif
+#ifndef ENGINE_SEARCH_TIME
+#define ENGINE_SEARCH_TIME 1.0  //seconds per move
+#endif
+#ifndef ENGINE_HASH_MB
+#define ENGINE_HASH_MB 16  //size of transposition table
+#endif
+//Size (MB) of the table of new engines. (server option -H)
+size_t ENGINE_HASH_SIZE = ENGINE_HASH_MB;
+#ifndef ENGINE_NTHREADS
+#define ENGINE_NTHREADS 1  //search threads
+#endif
+//Search threads of new engines. (server option -t)
+int ENGINE_THREADS = ENGINE_NTHREADS;
+#ifndef ENGINE_PONDER_ON
+#define ENGINE_PONDER_ON 0  //pondering is off by default
+#endif
+//Pondering of new engines. (server option -p)
+Flag ENGINE_PONDER = ENGINE_PONDER_ON;
+//Budget is checked once in these many nodes
+#define ENGINE_CHECK_NODES 1023
+//Null move pruning : depth reduction R, and the least depth
+#ifndef ENGINE_NULLMOVE
+#define ENGINE_NULLMOVE 1  //on by default
+#endif
+#ifndef ENGINE_NULL_R
+#define ENGINE_NULL_R 2
+#endif
+#define ENGINE_NULL_DEPTH 3
+//Late move reductions : moves searched before reducing, ..
+// .. and the least depth
+#ifndef ENGINE_LMR
+#define ENGINE_LMR 1  //on by default
+#endif
+#ifndef ENGINE_LMR_MOVES
+#define ENGINE_LMR_MOVES 3
+#endif
+#define ENGINE_LMR_DEPTH 3
+
+/* Search state of a thread. Each thread plays the moves ..
+.. on its own copy of the root board. Only the engine ..
+.. "e" (budget, stop flag, transposition table) is shared */
+typedef struct {
+  _Engine * e;
+  int id;           //0 : main thread
+  _Board board;
+  size_t nodes;
+  //Result of the last completed iteration of this thread
+  Move best;
+  int score, depthdone;
+  pthread_t thread;
+  //Move ordering heuristics (refer EngineOrderMoves())
+  Move played[ENGINE_MAX_PLY + 1];     //move played at each ply
+  Move killers[ENGINE_MAX_PLY + 1][2]; //killer moves of each ply
+  Move counters[16][64];  //[piece][to] of the previous move
+  int history[2][64][64]; //[color][from][to] of quiet moves
+  //Triangular PV table. pv[ply] is the principal variation ..
+  // .. of the node at "ply", found so far (refer EngineUpdatePV())
+  Move pv[ENGINE_MAX_PLY + 1][ENGINE_MAX_PLY + 1];
+  int pvlen[ENGINE_MAX_PLY + 1];
+  //PV of the last completed iteration
+  Move bestpv[ENGINE_MAX_PLY + 1];
+  int bestpvlen;
+  //Transposition table counters of this thread
+  _HashStats hashstats;
+}_EngineThread;
+
+//Wall clock time in seconds
+double EngineClock() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
 }
-*/
 
-Flag TreeReorderMoves(_Tree * node) {
-  if(node->flags & IS_LEAF_NODE)
-    return 0;
+#define ENGINE_STOPPED(E) __atomic_load_n(&(E)->stop, __ATOMIC_RELAXED)
+#define ENGINE_SET_STOP(E) \
+  __atomic_store_n(&(E)->stop, 1, __ATOMIC_RELAXED)
+
+/* Stop the search (of all threads), if the time/node budget ..
+.. is exhausted. Nodes of the thread are added to the ..
+.. shared count "e->nodes" in batches. There is no budget ..
+.. while pondering (till a ponder hit sets the deadline, ..
+.. and resets the count) */
+static inline Flag EngineStop(_EngineThread * t) {
+  _Engine * e = t->e;
+  if(!(t->nodes & ENGINE_CHECK_NODES)) {
+    size_t nodes = __atomic_add_fetch(&e->nodes, 
+      ENGINE_CHECK_NODES + 1, __ATOMIC_RELAXED);
+    if(!__atomic_load_n(&e->pondering, __ATOMIC_ACQUIRE) &&
+        ((e->maxnodes && nodes >= e->maxnodes) || 
+        EngineClock() >= e->deadline))
+      ENGINE_SET_STOP(e);
+  }
+  return ENGINE_STOPPED(e);
+}
+
+static inline int EngineEvaluate(_Board * b) {
+  int eval = NnueEvaluate(b), max = ENGINE_MATE - ENGINE_MAX_PLY - 1;
+  return eval > max ? max : eval < -max ? -max : eval;
+}
 
-  // Order the children of this node ,
-  // .. in accordance of their availability in hashtable,
-  // .. killer move, etc.
-  // Ordering helps to prune most of the tree.
-  return 1; 
+/* Mate scores are stored in the transposition table as ..
+.. distance to mate from the node (not from the root), ..
+.. so that they are valid wherever the node is reached */
+static inline int EngineScoreToHash(int score, int ply) {
+  return score >= ENGINE_MATE - ENGINE_MAX_PLY ? score + ply :
+    score <= -ENGINE_MATE + ENGINE_MAX_PLY ? score - ply : score;
 }
 
-Flag TreeNodeNegamax(_Tree * node) {
-  if(!node->depth)  {
-    //FIXME: use/search hashtable. Implement table 1st
-    node->eval = NnueEvaluate(&node->board);
+static inline int EngineScoreFromHash(int score, int ply) {
+  return score >= ENGINE_MATE - ENGINE_MAX_PLY ? score - ply :
+    score <= -ENGINE_MATE + ENGINE_MAX_PLY ? score + ply : score;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Move ordering. Alpha-beta prunes the most when the best ..
+  .. move is searched first, so the moves are searched in ..
+  .. the order
+    hash move (best move of an earlier search),
+    captures/promotions by MVV-LVA (most valuable victim ..
+    .. first, then least valuable attacker first),
+    killer moves (quiet moves that caused a cutoff in ..
+    .. another node of the same ply),
+    countermove (quiet move that refuted the previous move),
+    quiet moves by history (how often and how deep they ..
+    .. caused a cutoff).
+    captures that lose material (BoardSee() < 0).
+  Killers, countermoves and history are learnt during the ..
+  .. search (EngineCutoff()) and are private to the thread.
+    EngineOrderMoves(t, b, &moves, scores, ply, hashmove);
+    for(int i=0; i<moves.len; ++i) {
+      Move m = EnginePickMove(&moves, scores, i);
+  Moves are picked one at a time, since most nodes are ..
+  .. cut off after the first few moves.
+  Refer
+    https://www.chessprogramming.org/Move_Ordering
+------------------------------------------------------------
+--------------------------------------------------------- */
+#define ENGINE_ORDER_HASH    (1 << 30)
+#define ENGINE_ORDER_CAPTURE (1 << 28)
+#define ENGINE_ORDER_KILLER  (1 << 26)  //+1 for the first killer
+#define ENGINE_ORDER_COUNTER (ENGINE_ORDER_KILLER - 1)
+#define ENGINE_ORDER_BAD     (-ENGINE_ORDER_CAPTURE)
+//History is halved once an entry exceeds this
+#define ENGINE_HISTORY_MAX   (1 << 20)
+
+int EngineMoveScore(_EngineThread * t, _Board * b, Move m, int ply,
+    Move hashmove, Move counter) {
+  if(m == hashmove)
+    return ENGINE_ORDER_HASH;
+  Piece victim = BoardMoveCaptured(b, m);
+  if(victim != EMPTY || MOVE_IS_PROMOTION(m)) {
+    int value = PIECE_VALUE[victim] + (MOVE_IS_PROMOTION(m) ?
+      PIECE_VALUE[MOVE_PROMOTED(m)] : 0), 
+      attacker = PIECE_VALUE[b->pieces[MOVE_FROM(m)]];
+    //Captures losing material (by SEE) are searched last
+    if(!MOVE_IS_PROMOTION(m) && attacker > value && BoardSee(b, m) < 0)
+      return ENGINE_ORDER_BAD + 256 * value - attacker / 100;
+    return ENGINE_ORDER_CAPTURE + 256 * value - attacker / 100;
+  }
+  if(m == t->killers[ply][0])
+    return ENGINE_ORDER_KILLER + 1;
+  if(m == t->killers[ply][1])
+    return ENGINE_ORDER_KILLER;
+  if(m == counter)
+    return ENGINE_ORDER_COUNTER;
+  return t->history[b->color][MOVE_FROM(m)][MOVE_TO(m)];
+}
+
+//Countermove of the move played at "ply - 1"
+static inline Move EngineCounterMove(_EngineThread * t, _Board * b,
+    int ply) {
+  Move prev = ply ? t->played[ply - 1] : MOVE_NONE;
+  return prev == MOVE_NONE ? MOVE_NONE :
+    t->counters[b->pieces[MOVE_TO(prev)]][MOVE_TO(prev)];
+}
+
+void EngineOrderMoves(_EngineThread * t, _Board * b, 
+    MoveList * moves, int * scores, int ply, Move hashmove) {
+  Move counter = EngineCounterMove(t, b, ply);
+  for(int i=0; i<moves->len; ++i)
+    scores[i] = EngineMoveScore(t, b, moves->moves[i], ply, 
+      hashmove, counter);
+}
+
+//Bring the best of the moves [i:len) to "i"
+static inline Move EnginePickMove(MoveList * moves, int * scores, 
+    int i) {
+  int best = i;
+  for(int j=i+1; j<moves->len; ++j)
+    if(scores[j] > scores[best])
+      best = j;
+  Move m = moves->moves[best];
+  int score = scores[best];
+  moves->moves[best] = moves->moves[i];
+  scores[best] = scores[i];
+  moves->moves[i] = m;
+  scores[i] = score;
+  return m;
+}
+
+//Quiet move "m" caused a cutoff at "ply" of a "depth" search
+void EngineCutoff(_EngineThread * t, _Board * b, Move m, int depth,
+    int ply) {
+  if(t->killers[ply][0] != m) {
+    t->killers[ply][1] = t->killers[ply][0];
+    t->killers[ply][0] = m;
+  }
+  Move prev = ply ? t->played[ply - 1] : MOVE_NONE;
+  if(prev != MOVE_NONE)
+    t->counters[b->pieces[MOVE_TO(prev)]][MOVE_TO(prev)] = m;
+  int * h = &t->history[b->color][MOVE_FROM(m)][MOVE_TO(m)];
+  *h += depth * depth;
+  if(*h > ENGINE_HISTORY_MAX) {
+    //Old cutoffs matter less
+    int * entry = &t->history[0][0][0];
+    for(size_t i=0; i<sizeof(t->history)/sizeof(int); ++i)
+      entry[i] /= 2;
+  }
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Principal variation (PV), the line of play expected by ..
+  .. the search, is collected in a triangular table. When ..
+  .. the move "m" raises "alpha" at "ply", the PV of the ..
+  .. node is "m" followed by the PV of the child
+    EngineUpdatePV(t, ply, m);
+  Each node clears its PV (t->pvlen[ply] = 0) on entry.
+  Refer
+    https://www.chessprogramming.org/Triangular_PV-Table
+------------------------------------------------------------
+--------------------------------------------------------- */
+static inline void EngineUpdatePV(_EngineThread * t, int ply, Move m) {
+  int len = t->pvlen[ply + 1];
+  t->pv[ply][0] = m;
+  memcpy(&t->pv[ply][1], t->pv[ply + 1], len * sizeof(Move));
+  t->pvlen[ply] = len + 1;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Quiescence search. A leaf (depth 0) of the alpha-beta ..
+  .. search may be in the middle of an exchange, where a ..
+  .. static evaluation is meaningless (horizon effect). So ..
+  .. the leaves are extended by captures and promotions ..
+  .. (BoardCaptureMoves()) till the position is quiet.
+    score = EngineQuiescence(t, b, ply, alpha, beta);
+  The player to move may "stand pat" (decline to capture) ..
+  .. with the static evaluation as score, unless in check ..
+  .. (all the evasions are searched then). A capture that ..
+  .. can't raise the stand pat score to "alpha", even with ..
+  .. a margin ENGINE_DELTA, is not searched (delta pruning), ..
+  .. nor a capture that loses material (BoardSee() < 0).
+  Refer
+    https://www.chessprogramming.org/Quiescence_Search
+------------------------------------------------------------
+--------------------------------------------------------- */
+#ifndef ENGINE_DELTA
+#define ENGINE_DELTA 200  //centipawns
+#endif
+
+int EngineQuiescence(_EngineThread * t, _Board * b, int ply,
+    int alpha, int beta) {
+  t->pvlen[ply] = 0;
+  ++(t->nodes);
+  if(EngineStop(t))
+    return 0; //unused. Search is abandoned
+  if(ply >= ENGINE_MAX_PLY)
+    return EngineEvaluate(b);
+
+  _BoardMoveInfo info;
+  MoveList moves;
+  BoardCaptureMoves(b, &info, &moves);
+  Flag check = info.checkers != 0;
+  int stand = 0, best = -ENGINE_INFINITY;
+  if(check) {
+    if(!moves.len)
+      return -ENGINE_MATE + ply; //mated
   }
   else {
-    node->ichild = node->nchildren; //An invalid number
-    _Tree ** children = node->children;
-    assert(children);
-    node->eval = -ENGINE_EVAL_MAX;
-    for(int i=0; i<node->nchildren; ++i, ++children) {
-      _Tree * child = *children;
-      assert(child);
-      if( (-child->eval) > node->eval) {  
-        node->eval =  -child->eval;
-        node->ichild = i;
-      } 
+    stand = best = EngineEvaluate(b);
+    if(stand >= beta)
+      return stand;
+    if(stand > alpha)
+      alpha = stand;
+  }
+
+  int scores[MOVELIST_MAX];
+  EngineOrderMoves(t, b, &moves, scores, ply, MOVE_NONE);
+  _BoardUndo undo;
+  for(int i=0; i<moves.len; ++i) {
+    Move m = EnginePickMove(&moves, scores, i);
+    if(!check && !MOVE_IS_PROMOTION(m) && (scores[i] < 0 ||
+        stand + ENGINE_DELTA + PIECE_VALUE[BoardMoveCaptured(b, m)] 
+          <= alpha))
+      continue;
+    t->played[ply] = m;
+    BoardMakeMove(b, m, &undo);
+    int score = -EngineQuiescence(t, b, ply + 1, -beta, -alpha);
+    BoardUndoMove(b, m, &undo);
+    if(ENGINE_STOPPED(t->e))
+      return 0;
+    if(score > best) {
+      best = score;
+      if(score > alpha) {
+        alpha = score;
+        EngineUpdatePV(t, ply, m);
+      }
+      if(alpha >= beta)
+        break;
     }
-    assert(node->ichild < node->nchildren);
   }
+  return best;
+}
+
+int EngineAlphaBeta(_EngineThread * t, _Board * b, int depth,
+    int ply, int alpha, int beta);
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Principal variation search (PVS). With a good ordering, ..
+  .. the first move of a node is the best. So the rest are ..
+  .. only tested with a zero window (alpha, alpha + 1), ..
+  .. which is cheaper, and searched again with the full ..
+  .. window only if they beat "alpha". A move reduced by ..
+  .. "R" plies (late move reductions) is first searched ..
+  .. again unreduced.
+    score = EngineSearchMove(t, b, i, depth, R, ply, alpha, beta);
+  .. searches the "i"th move of the node at "ply", which ..
+  .. is already made on the board "b".
+  Refer
+    https://www.chessprogramming.org/Principal_Variation_Search
+------------------------------------------------------------
+--------------------------------------------------------- */
+int EngineSearchMove(_EngineThread * t, _Board * b, int i, int depth,
+    int R, int ply, int alpha, int beta) {
+  _Engine * e = t->e;
+  if(!i)
+    return -EngineAlphaBeta(t, b, depth - 1, ply + 1, -beta, -alpha);
+  int score = -EngineAlphaBeta(t, b, depth - 1 - R, ply + 1, 
+    -alpha - 1, -alpha);
+  if(R && score > alpha && !ENGINE_STOPPED(e))
+    score = -EngineAlphaBeta(t, b, depth - 1, ply + 1, 
+      -alpha - 1, -alpha);
+  if(score > alpha && score < beta && !ENGINE_STOPPED(e))
+    score = -EngineAlphaBeta(t, b, depth - 1, ply + 1, 
+      -beta, -alpha);
+  return score;
+}
+
+int EngineAlphaBeta(_EngineThread * t, _Board * b, int depth,
+    int ply, int alpha, int beta) {
+  _Engine * e = t->e;
+  if(depth <= 0)
+    return EngineQuiescence(t, b, ply, alpha, beta);
+  t->pvlen[ply] = 0;
+  ++(t->nodes);
+  if(EngineStop(t))
+    return 0; //unused. Search is abandoned
+
+  //Look for the result of an earlier search of this position. ..
+  // .. Not a cutoff in a PV node (open window), so that the ..
+  // .. PV is complete
+  Flag pvnode = beta - alpha > 1;
+  int alpha0 = alpha;
+  Move hashmove = MOVE_NONE;
+  _HashEntry entry;
+  if(e->table && 
+      HashTableProbe(e->table, b->hash, &entry, &t->hashstats)) {
+    int score = EngineScoreFromHash(HASH_SCORE(entry.data), ply);
+    Flag bound = HASH_BOUND(entry.data);
+    if(!pvnode && HASH_DEPTH(entry.data) >= depth && 
+        (bound == HASHTABLE_EXACT ||
+        (bound == HASHTABLE_LOWER && score >= beta) ||
+        (bound == HASHTABLE_UPPER && score <= alpha)))
+      return score;
+    hashmove = HASH_MOVE(entry.data);
+  }
+
+  if(ply >= ENGINE_MAX_PLY)
+    return EngineEvaluate(b);
+
+  MoveList moves;
+  if(BoardAllMoves(b, &moves) != GAME_CONTINUE)
+    //Mated (only the player to move can be) or a draw
+    return (b->status & GAME_IS_A_WIN) ? -ENGINE_MATE + ply : 0;
+
+  _BoardUndo undo;
+  Flag check = b->check;
+  //Null move pruning. If passing the turn still fails high ..
+  // .. on a reduced search, a real move would too. Not ..
+  // .. after a null move, nor in a PV node, nor in check, ..
+  // .. nor with only pawns ..
+  // .. (zugzwang), nor when looking for a mate.
+  if(e->nullmove && !pvnode && ply && !check && 
+      depth >= ENGINE_NULL_DEPTH &&
+      t->played[ply - 1] != MOVE_NONE && 
+      beta < ENGINE_MATE - ENGINE_MAX_PLY &&
+      BoardHasPieces(b, b->color) && EngineEvaluate(b) >= beta) {
+    int R = depth > 6 ? ENGINE_NULL_R + 1 : ENGINE_NULL_R;
+    t->played[ply] = MOVE_NONE;
+    BoardMakeNullMove(b, &undo);
+    int score = -EngineAlphaBeta(t, b, depth - 1 - R, ply + 1,
+      -beta, -beta + 1);
+    BoardUndoNullMove(b, &undo);
+    if(ENGINE_STOPPED(e))
+      return 0;
+    if(score >= beta)
+      //Unproven mate scores are not returned
+      return score >= ENGINE_MATE - ENGINE_MAX_PLY ? beta : score;
+  }
+
+  int scores[MOVELIST_MAX];
+  EngineOrderMoves(t, b, &moves, scores, ply, hashmove);
+
+  int best = -ENGINE_INFINITY;
+  Move bestmove = MOVE_NONE;
+  for(int i=0; i<moves.len; ++i) {
+    Move m = EnginePickMove(&moves, scores, i);
+    Flag quiet = BoardMoveCaptured(b, m) == EMPTY && 
+      !MOVE_IS_PROMOTION(m);
+    //Late move reductions. Quiet moves ordered late are ..
+    // .. unlikely to be the best, so they are searched to a ..
+    // .. lesser depth, and again to the full depth only if ..
+    // .. they beat "alpha". Checks are not reduced, unless ..
+    // .. the checking piece is just lost (BoardSee() < 0).
+    Flag late = e->lmr && i >= ENGINE_LMR_MOVES && 
+      depth >= ENGINE_LMR_DEPTH && quiet && !check && 
+      scores[i] < ENGINE_ORDER_COUNTER;
+    Flag badcheck = late && BoardSee(b, m) < 0;
+    t->played[ply] = m;
+    BoardMakeMove(b, m, &undo);
+    int R = 0;
+    if(late && (!b->check || badcheck))
+      R = depth > 5 && i > 3 * ENGINE_LMR_MOVES ? 2 : 1;
+    int score = EngineSearchMove(t, b, i, depth, R, ply, alpha, beta);
+    BoardUndoMove(b, m, &undo);
+    if(ENGINE_STOPPED(e))
+      return 0;
+    if(score > best) {
+      best = score;
+      if(score > alpha) {
+        alpha = score;
+        bestmove = m;
+        if(pvnode)
+          EngineUpdatePV(t, ply, m);
+      }
+      if(alpha >= beta) {
+        //cutoff. Opponent won't allow this line
+        if(quiet)
+          EngineCutoff(t, b, m, depth, ply);
+        break;
+      }
+    }
+  }
+
+  if(e->table)
+    HashTableStore(e->table, b->hash, depth, 
+      best >= beta ? HASHTABLE_LOWER : 
+      best > alpha0 ? HASHTABLE_EXACT : HASHTABLE_UPPER,
+      EngineScoreToHash(best, ply), bestmove, &t->hashstats);
+  return best;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Search the root moves (in that order) with the window ..
+  .. (alpha, beta) using PVS. 
+    score = EngineRoot(t, &moves, depth, alpha, beta, &ibest, &n);
+  .. returns the score of the best move "ibest" (the first ..
+  .. move, if none beats "alpha"). "n" is the number of ..
+  .. moves searched before the budget is exhausted.
+------------------------------------------------------------
+--------------------------------------------------------- */
+int EngineRoot(_EngineThread * t, MoveList * moves, int depth,
+    int alpha, int beta, Move * ibest, int * nsearched) {
+  _Board * board = &t->board;
+  _BoardUndo undo;
+  int best = -ENGINE_INFINITY;
+  *ibest = moves->moves[0];
+  *nsearched = 0;
+  for(int i=0; i<moves->len; ++i) {
+    Move m = moves->moves[i];
+    t->played[0] = m;
+    BoardMakeMove(board, m, &undo);
+    int score = EngineSearchMove(t, board, i, depth, 0, 0, 
+      alpha, beta);
+    BoardUndoMove(board, m, &undo);
+    if(ENGINE_STOPPED(t->e))
+      break;
+    ++(*nsearched);
+    if(score > best) {
+      best = score;
+      if(score > alpha) {
+        alpha = score;
+        *ibest = m;
+        EngineUpdatePV(t, 0, m);
+      }
+      if(alpha >= beta)
+        break;
+    }
+  }
+  return best;
+}
+
+//Move "m" of the list is searched first
+static inline void EngineMoveToFront(MoveList * moves, Move m) {
+  for(int i=0; i<moves->len; ++i)
+    if(moves->moves[i] == m) {
+      moves->moves[i] = moves->moves[0];
+      moves->moves[0] = m;
+      break;
+    }
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Iterative deepening. The root board "t->board" is ..
+  .. searched to depth 1, 2, .. e->depth till the budget ..
+  .. (e->time seconds or e->maxnodes nodes) is exhausted.
+    Move best = EngineIterate(t);
+  .. returns the best move of the last completed iteration
+  .. (MOVE_NONE if the game is over). The best move of an ..
+  .. iteration is searched first in the next iteration, ..
+  .. so a better move found by an unfinished iteration ..
+  .. is also trusted. Score, the depth completed and the ..
+  .. PV are stored in "t->score", "t->depthdone" and ..
+  .. "t->bestpv".
+  Aspiration windows : an iteration is expected to score ..
+  .. close to the previous one. So it is searched with a ..
+  .. narrow window (score - delta, score + delta) which ..
+  .. prunes more, and searched again with a wider window ..
+  .. (delta doubled), if the score falls outside.
+  Refer
+    https://www.chessprogramming.org/Aspiration_Windows
+------------------------------------------------------------
+--------------------------------------------------------- */
+#ifndef ENGINE_WINDOW
+#define ENGINE_WINDOW 25  //centipawns
+#endif
+#define ENGINE_WINDOW_DEPTH 4  //least depth with a narrow window
+
+Move EngineIterate(_EngineThread * t) {
+  _Engine * e = t->e;
+  _Board * board = &t->board;
+  t->best = MOVE_NONE;
+  t->score = -ENGINE_INFINITY;
+  t->depthdone = 0;
+  t->bestpvlen = 0;
+
+  MoveList moves;
+  if(BoardAllMoves(board, &moves) != GAME_CONTINUE)
+    return MOVE_NONE;
+
+  //Root moves are ordered once. Later, the best move of ..
+  // .. an iteration is moved to the front
+  _HashEntry entry;
+  int scores[MOVELIST_MAX];
+  EngineOrderMoves(t, board, &moves, scores, 0, 
+    e->table && HashTableProbe(e->table, board->hash, &entry, 
+      &t->hashstats) ?
+    HASH_MOVE(entry.data) : MOVE_NONE);
+  for(int i=0; i<moves.len; ++i)
+    EnginePickMove(&moves, scores, i);
+
+  Move best = moves.moves[0];
+  t->best = best;
+  //Helpers of odd id are a ply ahead of the main thread
+  for(int depth = 1 + (t->id & 1); depth <= e->depth; ++depth) {
+    int alpha = -ENGINE_INFINITY, beta = ENGINE_INFINITY, 
+      delta = ENGINE_WINDOW, score, nsearched;
+    if(depth >= ENGINE_WINDOW_DEPTH && t->depthdone &&
+        abs(t->score) < ENGINE_MATE - ENGINE_MAX_PLY) {
+      alpha = t->score - delta;
+      beta = t->score + delta;
+    }
+    Move ibest;
+    while(1) {
+      score = EngineRoot(t, &moves, depth, alpha, beta, &ibest, 
+        &nsearched);
+      if(ENGINE_STOPPED(e))
+        break;
+      if(score <= alpha) 
+        alpha = score - delta < -ENGINE_INFINITY ? 
+          -ENGINE_INFINITY : score - delta;
+      else if(score >= beta) {
+        beta = score + delta > ENGINE_INFINITY ? 
+          ENGINE_INFINITY : score + delta;
+        //Fail high. "ibest" is better than the previous best
+        best = ibest;
+        t->best = best;
+        EngineMoveToFront(&moves, best);
+      }
+      else
+        break;
+      delta *= 2;
+    }
+    //Unfinished iteration. Trust only if the previous best ..
+    // .. move is searched (and it is beaten by "ibest").
+    Flag stopped = ENGINE_STOPPED(e);
+    if(stopped && (nsearched < 2 || ibest == best))
+      break;
+
+    best = ibest;
+    t->best = best;
+    t->score = score;
+    t->depthdone = depth;
+    t->bestpvlen = t->pvlen[0];
+    memcpy(t->bestpv, t->pv[0], t->pvlen[0] * sizeof(Move));
+    if(stopped)
+      break;
+    //Best move is searched first in the next iteration
+    EngineMoveToFront(&moves, best);
+    //A forced mate is found. No need to go deeper
+    if(score >= ENGINE_MATE - ENGINE_MAX_PLY || 
+        score <= -ENGINE_MATE + ENGINE_MAX_PLY)
+      break;
+  }
+  return best;
+}
+
+static void * EngineWorker(void * arg) {
+  EngineIterate((_EngineThread *) arg);
+  return NULL;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Lazy SMP. The root "e->tree->board" is searched by ..
+  .. e->nthreads threads at once
+    Move best = EngineSearch(e);
+  .. (or the board "root", by EngineSearchFrom(e, root), ..
+  .. with the deadline "e->deadline" set by the caller) ..
+  .. The helper threads (id 1, 2, ..) run the same ..
+  .. iterative deepening (EngineIterate()) as the main ..
+  .. thread (id 0), with no communication other than the ..
+  .. shared transposition table "e->table". Results of a ..
+  .. thread are cutoffs/best moves for the others, and ..
+  .. helpers of odd id search a ply deeper, so that the ..
+  .. threads soon diverge. Move, score and depth of the ..
+  .. main thread are reported. Helpers are stopped once ..
+  .. the main thread is done. 
+  Refer
+    https://www.chessprogramming.org/Lazy_SMP
+------------------------------------------------------------
+--------------------------------------------------------- */
+Move EngineSearchFrom(_Engine * e, _Board * root) {
+  int n = e->nthreads > 1 ? e->nthreads : 1;
+  _EngineThread * threads = 
+    (_EngineThread *) malloc(n * sizeof(_EngineThread));
+  if(!threads) {
+    GameError("EngineSearch() : Out of memory");
+    return MOVE_NONE;
+  }
+  e->nodes = 0;
+  if(e->table)
+    HashTableNewSearch(e->table);
+
+  for(int i=0; i<n; ++i) {
+    _EngineThread * t = &threads[i];
+    t->e = e;
+    t->id = i;
+    t->nodes = 0;
+    BoardCopy(&t->board, root);
+    memset(t->killers, 0, sizeof(t->killers));
+    memset(t->counters, 0, sizeof(t->counters));
+    memset(t->history, 0, sizeof(t->history));
+    memset(&t->hashstats, 0, sizeof(_HashStats));
+  }
+  //A helper that couldn't be created is just skipped
+  Flag running[n];
+  for(int i=1; i<n; ++i)
+    running[i] = !pthread_create(&threads[i].thread, NULL,
+      EngineWorker, &threads[i]);
+
+  Move best = EngineIterate(&threads[0]);
+  ENGINE_SET_STOP(e);
+
+  size_t nodes = threads[0].nodes;
+  for(int i=1; i<n; ++i)
+    if(running[i]) {
+      pthread_join(threads[i].thread, NULL);
+      nodes += threads[i].nodes;
+    }
+  e->nodes = nodes;
+  //Threads are over. Counters go to the table
+  if(e->table)
+    for(int i=0; i<n; ++i)
+      HashTableAddStats(e->table, &threads[i].hashstats);
+  e->score = threads[0].score;
+  e->depthdone = threads[0].depthdone;
+  //PV of the main thread (at least the move played)
+  e->pvlen = threads[0].bestpvlen;
+  memcpy(e->pv, threads[0].bestpv, e->pvlen * sizeof(Move));
+  if(best != MOVE_NONE && (!e->pvlen || e->pv[0] != best)) {
+    e->pv[0] = best;
+    e->pvlen = 1;
+  }
+  free(threads);
+  return best;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Pondering : searching on the opponent's time. Once the ..
+  .. engine moves, the position after the opponent's reply ..
+  .. predicted by the PV (e->pv[1]) is searched in a ..
+  .. background thread, without any budget
+    EnginePonder(e);
+  When the opponent moves (EnginePonderMove(e, m)), the ..
+  .. ponder search is either stopped and discarded (a ..
+  .. different move), or continued as the real search with ..
+  .. the usual budget from then on (ponder hit). The ..
+  .. result of a ponder hit is collected by the next ..
+  .. EngineSearch(), so that the engine had the thinking ..
+  .. time of the opponent too.
+    EnginePonderStop(e);
+  .. discards the ponder search (if any).
+------------------------------------------------------------
+--------------------------------------------------------- */
+enum ENGINE_PONDER_STATE {
+  ENGINE_PONDER_NONE = 0,
+  ENGINE_PONDER_RUNNING = 1, //waiting for the opponent's move
+  ENGINE_PONDER_HIT = 2      //opponent played the predicted move
+};
+
+static void * EnginePonderWorker(void * arg) {
+  _Engine * e = (_Engine *) arg;
+  e->ponderbest = EngineSearchFrom(e, &e->ponderboard);
+  return NULL;
+}
+
+Flag EnginePonder(_Engine * e) {
+  if(!e->ponder || e->ponderstate != ENGINE_PONDER_NONE || 
+      e->pvlen < 2)
+    return 0;
+  //Predicted reply should be a legal move of the opponent
+  Move m = e->pv[1];
+  MoveList moves;
+  _BoardUndo undo;
+  BoardCopy(&e->ponderboard, &e->tree->board);
+  if(BoardAllMoves(&e->ponderboard, &moves) != GAME_CONTINUE)
+    return 0;
+  int i = 0;
+  while(i < moves.len && moves.moves[i] != m)
+    ++i;
+  if(i == moves.len)
+    return 0;
+  BoardMakeMove(&e->ponderboard, m, &undo);
+
+  e->pondermove = m;
+  e->ponderbest = MOVE_NONE;
+  e->stop = 0;
+  e->deadline = INFINITY;
+  __atomic_store_n(&e->pondering, 1, __ATOMIC_RELEASE);
+  if(pthread_create(&e->ponderthread, NULL, EnginePonderWorker, e)) {
+    e->pondering = 0;
+    return 0;
+  }
+  e->ponderstate = ENGINE_PONDER_RUNNING;
   return 1;
 }
 
-Flag EngineMinimax(_Engine * e) {
-  /* Run the minimax evaluate algo*/
+void EnginePonderStop(_Engine * e) {
+  if(e->ponderstate == ENGINE_PONDER_NONE)
+    return;
+  ENGINE_SET_STOP(e);
+  pthread_join(e->ponderthread, NULL);
+  e->ponderstate = ENGINE_PONDER_NONE;
+  e->pondering = 0;
+}
+
+//Opponent played the move "m"
+void EnginePonderMove(_Engine * e, Move m) {
+  if(e->ponderstate != ENGINE_PONDER_RUNNING)
+    return;
+  if(m != e->pondermove) {
+    EnginePonderStop(e);
+    return;
+  }
+  //Ponder hit. Budget of the search (time and nodes) ..
+  // .. starts now. Total nodes are summed up at the end anyway
+  e->deadline = EngineClock() + e->time;
+  __atomic_store_n(&e->nodes, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->pondering, 0, __ATOMIC_RELEASE);
+  e->ponderstate = ENGINE_PONDER_HIT;
+}
+
+Move EngineSearch(_Engine * e) {
+  if(e->ponderstate == ENGINE_PONDER_HIT) {
+    //Wait for the ponder search (running on this position)
+    pthread_join(e->ponderthread, NULL);
+    e->ponderstate = ENGINE_PONDER_NONE;
+    if(e->ponderbest != MOVE_NONE && 
+        e->ponderboard.hash == e->tree->board.hash)
+      return e->ponderbest;
+  }
+  EnginePonderStop(e);
+  e->stop = 0;
+  e->deadline = EngineClock() + e->time;
+  return EngineSearchFrom(e, &e->tree->board);
+}
+
+/* Result of the last search as a text (to show the ..
+.. analysis) like
+    "depth 9 score 31 nodes 120567 pv e2e4 e7e5 g1f3"
+.. where "s" can hold ENGINE_INFO_MAXSIZE characters */
+#define ENGINE_INFO_MAXSIZE (64 + 6 * ENGINE_MAX_PLY)
+
+void EngineInfo(_Engine * e, char * s) {
+  s += sprintf(s, "depth %d score %d nodes %lu pv", e->depthdone,
+    e->score, (unsigned long) e->nodes);
+  for(int i=0; i<e->pvlen; ++i) {
+    Move m = e->pv[i];
+    s += sprintf(s, " %c%c%c%c", 
+      'a' + MOVE_FROM(m)%8, '0' + 8 - MOVE_FROM(m)/8,
+      'a' + MOVE_TO(m)%8, '0' + 8 - MOVE_TO(m)/8);
+    if(MOVE_IS_PROMOTION(m))
+      s += sprintf(s, "%c", MAPPING[MOVE_PROMOTED(m)]);
+  }
+}
+
+Flag EngineAlphaBetaMove(_Engine * e) {
+  /* Search the best move and advance the tree with it */
   _Tree * root = e->tree;
-    
-  TreeEachNodePostOrder(root, root->depth, TreeNodeNegamax);
-  //this is the most "ideal" move acc to engine
-  //_Tree * next = root->children[root->ichild];
+  Move best = EngineSearch(e);
+  if(best == MOVE_NONE) {
+    GameError("EngineAlphaBetaMove : Game over");
+    return 0;
+  }
 
-  Flag ichild = root->ichild;
+  //Find the child of the root node corresponding to the move
+  TreeWait();
+  Flag ichild = root->nchildren;
+  for(Flag i=0; i<root->nchildren; ++i) 
+    if(root->children[i]->move == best) {
+      ichild = i;
+      break;
+    }
 
+  root->eval = e->score;
   _Tree * next = TreeNext(root, ichild);
   if(!next) {
-    GameError("EngineMinimax : TreeNext() failed");
+    GameError("EngineAlphaBetaMove : TreeNext() failed");
     return 0;
   }
 
@@ -231,9 +1078,10 @@ Flag EngineMinimax(_Engine * e) {
   return 1;
 }
 
-
 _Engine * EngineNew(_Board * board, Flag mycolor) {
-  _Tree * tree = Tree(board, TREE_MAX_DEPTH);
+  //Tree is only used to keep track of the moves played. ..
+  // .. The search (EngineSearch()) doesn't need the tree.
+  _Tree * tree = Tree(board, TREE_MIN_DEPTH);
   if(!tree) { 
     GameError("EngineNew() : Couldn't create tree");
     return NULL;
@@ -242,11 +1090,29 @@ _Engine * EngineNew(_Board * board, Flag mycolor) {
   e->tree = tree;
   e->mycolor = mycolor;
   e->update_tree = EngineUpdateTree; 
-  e->engine = EngineMinimax;
+  e->engine = EngineAlphaBetaMove;
+  e->depth = ENGINE_SEARCH_DEPTH;
+  e->time = ENGINE_SEARCH_TIME;
+  e->maxnodes = 0;
+  e->nthreads = ENGINE_THREADS;
+  e->nullmove = ENGINE_NULLMOVE;
+  e->lmr = ENGINE_LMR;
+  e->score = 0;
+  e->depthdone = 0;
+  e->pvlen = 0;
+  e->ponder = ENGINE_PONDER;
+  e->ponderstate = ENGINE_PONDER_NONE;
+  e->pondering = 0;
+  e->nodes = 0;
+  e->stop = 0;
+  //Table is shared by all the search threads of the engine
+  e->table = HashTable(ENGINE_HASH_SIZE, HASHTABLE_DEPTH);
   return e;
 }
 
 void EngineDestroy(_Engine * e){
+  EnginePonderStop(e);
   TreeDestroy(e->tree);
+  HashTableDestroy(e->table);
   free(e);
 }
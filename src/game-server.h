@@ -200,27 +200,38 @@ Flag ServerMove( ws_cli_conn_t client,
   }
 
   //Engine Make a move on GAME_SERVER.
-  _BoardMove * m = GameEngineMove(GAME_SERVER);
-  if(!m) {
+  Move m = GameEngineMove(GAME_SERVER);
+  if(m == MOVE_NONE) {
     ServerError(client, 
       "Error : Engine Failed to make a move");
     return GAME_STATUS_ERROR;
   }
     
   GamePrintBoard(GAME_SERVER, 0); //0 delay
+#ifndef DISABLE_VERBOSE
+  if(engine->table)
+    HashTablePrintStats(engine->table);
+#endif
  
   //Encode return message with the move information 
   char ret_msg[7] = {'m',
-    'a' + m->from.square%8,
-    '0' + 8 - m->from.square/8,
-    'a' + m->to.square%8,
-    '0' + 8 - m->to.square/8,
-    !(m->flags & MOVE_PROMOTION) ? '\0' : 
-          MAPPING[m->promotion&~WHITE],
+    'a' + MOVE_FROM(m)%8,
+    '0' + 8 - MOVE_FROM(m)/8,
+    'a' + MOVE_TO(m)%8,
+    '0' + 8 - MOVE_TO(m)/8,
+    !MOVE_IS_PROMOTION(m) ? '\0' : MAPPING[MOVE_PROMOTED(m)],
     '\0'
   };
   ServerSend(client, ret_msg);
 
+  //Analysis of the engine (score, principal variation, ..)
+  char info[ENGINE_INFO_MAXSIZE + 1] = "t";
+  EngineInfo(engine, info + 1);
+  ServerSend(client, info);
+
+  //Think on the opponent's time (if pondering is on)
+  EnginePonder(engine);
+
   return GameStatus(GAME_SERVER);
 }
 
@@ -290,17 +301,16 @@ Flag ClientMove( ws_cli_conn_t client,
     return GAME_STATUS_ERROR;
   }
 
-  BoardMakeAvailable(board);
-  
   //GameStatus(GAME_SERVER);
 
-  Flag nmoves = 
-    (Flag) (GAME_SERVER->moves->len/sizeof(_BoardMove) );
-  _BoardMove * move = (_BoardMove *) GAME_SERVER->moves->p;
+  Flag nmoves = (Flag) GAME_SERVER->moves->len;
+  Move * move = GAME_SERVER->moves->moves;
   for(int i=0; i<nmoves; ++i, ++move) {
-    if(move->from.square == from && move->to.square == to &&
-       move->promotion == promotion) {
-      Flag status = GamePlayerMove(GAME_SERVER, move);
+    Piece promoted = MOVE_IS_PROMOTION(*move) ? 
+      (MOVE_PROMOTED(*move) | board->color) : EMPTY;
+    if(MOVE_FROM(*move) == from && MOVE_TO(*move) == to &&
+       promoted == promotion) {
+      Flag status = GamePlayerMove(GAME_SERVER, *move);
       if(status == GAME_STATUS_ERROR) {
         ServerError(client, 
   "Error : Cannot Move the board or Update the Engine");
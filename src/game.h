@@ -4,8 +4,8 @@
 ------------------------------------------------------------
   3 structs commonly used in this header file.
   a) unsigned char : A square of the chessboard
-  b) _BoardMove : Info corresponding to a move from ..
-    the current board location
+  b) Move : A move (16 bit packed) from the current ..
+    board location. Refer board.h
   c) _Game : Store all the information corresponding to ..
     a chess game including board information, other ..
     informations like whose move, location of each kings,
@@ -18,7 +18,8 @@ typedef struct {
   _Board * board;
   //Other Info
   char fen[FEN_MAXSIZE];
-  Array * moves, * history;
+  MoveList * moves;
+  Array * history;
   //Engine 
   _Engine * engine;
 }_Game;
@@ -82,30 +83,36 @@ Flag GameSetBoard(_Game * g, const char * _fen) {
 /* ---------------------------------------------------------
 ------------------------------------------------------------
   Updating the game history. The functions ..
-    GamePushHistory(_Game * g); 
-  .. may be called after each move, in case you need to ..
-  .. revert any move (while analysing the game) or you ..
-  .. want to save the game. 
+    GamePushHistory(_Game * g, move, &undo); 
+  .. may be called after each move (made with ..
+  .. BoardMakeMove()), in case you need to revert any ..
+  .. move (while analysing the game) or you want to save ..
+  .. the game. Only the move and its undo record are ..
+  .. stored, not the board.
   The function
     GamePopHistory(_Game * g);
   .. undo the last move.
 ------------------------------------------------------------
 --------------------------------------------------------- */
 
-void GamePushHistory(_Game * g, _BoardMove * move){
+typedef struct {
+  Move move;
+  _BoardUndo undo;
+}_GameHistory;
+
+void GamePushHistory(_Game * g, Move move, _BoardUndo * undo){
   if(!g->history)
     g->history = array_new(); 
-  /** Add the current board and specified move to history */
-  array_append ( g->history, g->board, sizeof(_Board) );
-  array_append ( g->history, move, sizeof(_BoardMove) );
-  //TODO: Add move also to the history 
+  /** Add the specified move (and its undo) to history */
+  _GameHistory h = { .move = move, .undo = *undo };
+  array_append ( g->history, &h, sizeof(_GameHistory) );
 }
 
 Flag GamePopHistory(_Game * g){
   /** Remove last move from history. ..
   .. In case of reverting a move */
   Array * h = g->history;
-  size_t size =  sizeof(_Board) + sizeof(_BoardMove);
+  size_t size =  sizeof(_GameHistory);
   if(!h) {
     fprintf(stderr, "Warning: History not allocated");
     return 0;
@@ -115,7 +122,8 @@ Flag GamePopHistory(_Game * g){
     return 0;
   }
   h->len -= size;
-  BoardCopy(g->board, (_Board *) (( (char *) h->p) + h->len));
+  _GameHistory * last = (_GameHistory *) (( (char *) h->p) + h->len);
+  BoardUndoMove(g->board, last->move, &last->undo);
   //validate board;?
   BoardAllMoves(g->board, g->moves);
   return 1;
@@ -152,31 +160,34 @@ void GameFEN(_Game * g){
 //}
 
 //Next Move
-Flag GameMove(_Game * g, _BoardMove * move){
+Flag GameMove(_Game * g, Move move){
 
-  if(! (g && move)) {
+  if(! (g && move != MOVE_NONE)) {
     GameError("Game/move not available");
     return GAME_STATUS_ERROR;
   }
-  GamePushHistory(g, move);
+  _BoardUndo undo;
+  if(BoardMakeMove(g->board, move, &undo) == GAME_STATUS_ERROR)
+    return GAME_STATUS_ERROR;
+  GamePushHistory(g, move, &undo);
   //fprintf(stderr, "\nLen %ld", g->history->len); 
-  Flag status = BoardNext(g->board,move,g->moves);
+  Flag status = BoardAllMoves(g->board, g->moves);
   GameFEN(g); //may switch of this
 
   return status;
 }
 
-Flag GamePlayerMove(_Game * g, _BoardMove * move) {
-  _BoardMove m; 
-  memcpy(&m, move, sizeof(_BoardMove));
+Flag GamePlayerMove(_Game * g, Move m) {
   Flag color = g->board->color; 
-  Flag status = GameMove(g, &m);
+  Flag status = GameMove(g, m);
   _Engine * engine = g->engine;
   if (!engine) {
     GameError("Player Move : No engine Found");
     return GAME_STATUS_ERROR;
   }
-  if(!engine->update_tree(engine, &m)) {
+  //Ponder hit, or the ponder search is discarded
+  EnginePonderMove(engine, m);
+  if(!engine->update_tree(engine, m)) {
     GameError("Player move : Engine Couldn't find move");
     return GAME_STATUS_ERROR;
   }
@@ -188,24 +199,24 @@ Flag GamePlayerMove(_Game * g, _BoardMove * move) {
   return status;
 }
 
-_BoardMove * GameEngineMove(_Game * g) {
+Move GameEngineMove(_Game * g) {
   _Engine * engine = g->engine;
   if(!engine) {
     GameError("Engine Move : Engine Not Found");
-    return NULL;
+    return MOVE_NONE;
   }
   if(g->board->color != engine->mycolor) {
     //It's not engine;s turn;
     GameError("Engine Move : Not Engine's turn");
-    return NULL;
+    return MOVE_NONE;
   }
   if( !engine->engine(engine) ) {
     GameError("Engine Move : Engine Not Found");
-    return NULL;
+    return MOVE_NONE;
   }
-  _BoardMove * move = &engine->tree->move;
+  Move move = engine->tree->move;
   if (GameMove(g, move) == GAME_STATUS_ERROR)
-    return NULL;
+    return MOVE_NONE;
   return move;
 }
 
@@ -230,9 +241,13 @@ Flag GameUnmove(_Game * g){
 
   //Update engine, if running
   _Engine * e = g->engine;
-  if(e)
-    // A costly process to redo the tree
+  if(e) {
+    //Ponder search was on the undone position
+    EnginePonderStop(e);
+    //Root moves back to the retained previous root (the tree ..
+    // .. is rebuilt only if it's not retained)
     e->tree = TreePrev(e->tree, g->board); 
+  }
 
   //status of the game if undo was successfull
   return g->board->status;
@@ -241,15 +256,14 @@ Flag GameUnmove(_Game * g){
 Flag GameBot(_Game * g) {
   // Algorithm Not yet implemented
   // Random move (As of now)
-  _BoardMove * move = NULL;
+  Move move = MOVE_NONE;
       
   if(g->moves->len) {
     
-    int nmoves = (g->moves->len) / sizeof(_BoardMove);
+    int nmoves = g->moves->len;
 
-    move = (_BoardMove *) g->moves->p;
     int imove = floor (((double) nmoves)*rand()/RAND_MAX);
-    move += imove;
+    move = g->moves->moves[imove];
   }
       
   return GameMove(g, move); 
@@ -287,7 +301,7 @@ void GameDestroy(_Game * g) {
   if(g->engine)
     EngineDestroy(g->engine);
   if(g->moves) 
-    array_free(g->moves);
+    free(g->moves);
   if(g->history)
     array_free(g->history);
   free(g);
@@ -308,7 +322,7 @@ _Game * GameNew(char * fen){
   }
     
   //Allocate memory for possible moves,
-  Array * moves = array_new();
+  MoveList * moves = (MoveList *) malloc (sizeof (MoveList));
   g->moves = moves; 
   //Allocate memory for game history.
   Array * history = array_new();
@@ -0,0 +1,234 @@
+#include "tree.h"
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Transposition table (TT). Results of the search of a ..
+  .. position (score, best move, ..) are stored against ..
+  .. the zobrist key "b->hash" of the position, so that ..
+  .. the same position reached through a different order ..
+  .. of moves (a transposition) is not searched again.
+  The table is an array of 2^n buckets. A bucket has ..
+  .. HASHTABLE_BUCKET entries (fits a 64 byte cache line) ..
+  .. and a key can be stored in any entry of its bucket ..
+  .. (bucket = key & mask).
+    _HashTable * t = HashTable(mb, policy); // size in MB
+    HashTableNewSearch(t);   // before each search
+    HashTableProbe(t, key, &entry, &stats);
+    HashTableStore(t, key, depth, bound, score, move, &stats);
+    HashTableDestroy(t);
+  The table can be shared by any number of search threads ..
+  .. without any lock. An entry is stored as two words
+    check = key ^ data, data
+  .. written (and read) by two independent atomic ..
+  .. operations. A probe racing with a store (or two ..
+  .. racing stores) may see words of different writes, ..
+  .. in which case "check ^ data" is not the key and the ..
+  .. torn entry is just a miss. Probes and stores are ..
+  .. counted in "stats" (can be NULL) owned by the caller ..
+  .. (a search thread), and not in the shared table, and ..
+  .. summed up by HashTableAddStats() once a search is over.
+  Refer
+    https://www.chessprogramming.org/Transposition_Table
+    https://www.chessprogramming.org/Shared_Hash_Table
+------------------------------------------------------------
+--------------------------------------------------------- */
+
+//Score is exact, or a lower/upper bound (after a cutoff)
+enum HASHTABLE_BOUND {
+  HASHTABLE_NONE  = 0,
+  HASHTABLE_UPPER = 1,  // score <= alpha. (fail low)
+  HASHTABLE_LOWER = 2,  // score >= beta. (fail high)
+  HASHTABLE_EXACT = 3
+};
+
+/* Replacement policy, when a new result of a key is ..
+.. stored : HASHTABLE_DEPTH keeps the deeper result of ..
+.. the key from the current search (unless the new one is ..
+.. exact), while HASHTABLE_ALWAYS overwrites it. When the ..
+.. key is not in the bucket, both replace the entry from ..
+.. an older search first, then the shallowest one. */
+enum HASHTABLE_POLICY {
+  HASHTABLE_DEPTH  = 0,
+  HASHTABLE_ALWAYS = 1
+};
+
+#define HASHTABLE_BUCKET 4
+
+/* An entry is two 64 bit words, "check" (key ^ data) and ..
+.. the "data"
+    bits [ 0:16) : best move (Move)
+    bits [16:32) : score (int16_t)
+    bits [32:40) : depth
+    bits [40:42) : bound (HASHTABLE_BOUND)
+    bits [42:50) : age (search number, modulo 256) */
+typedef struct {
+  uint64_t check, data;
+} _HashEntry;
+
+#define HASH_DATA(MOVE,SCORE,DEPTH,BOUND,AGE)      \
+  ( (uint64_t) (MOVE) |                            \
+    ((uint64_t) (uint16_t) (int16_t) (SCORE) << 16) | \
+    ((uint64_t) (uint8_t) (DEPTH) << 32) |         \
+    ((uint64_t) (BOUND) << 40) |                   \
+    ((uint64_t) (uint8_t) (AGE) << 42) )
+#define HASH_MOVE(D)  ((Move) ((D) & 0xFFFF))
+#define HASH_SCORE(D) ((int) (int16_t) (((D) >> 16) & 0xFFFF))
+#define HASH_DEPTH(D) ((int) (((D) >> 32) & 0xFF))
+#define HASH_BOUND(D) ((Flag) (((D) >> 40) & 3))
+#define HASH_AGE(D)   ((uint8_t) (((D) >> 42) & 0xFF))
+
+//Counters for tuning. A collision is a store that evicts ..
+// .. a live entry of another key
+typedef struct {
+  size_t probes, hits, stores, collisions;
+} _HashStats;
+
+typedef struct {
+  _HashEntry * entries;  //HASHTABLE_BUCKET entries per bucket
+  uint64_t mask;         //number of buckets - 1
+  size_t nbuckets;
+  uint8_t age;           //incremented every search
+  Flag policy;           //HASHTABLE_POLICY
+  void * memory;         //unaligned memory (to be freed)
+  _HashStats stats;      //of the searches so far
+} _HashTable;
+
+//Relaxed atomics : no ordering b/w the two words is needed
+#define HASHTABLE_LOAD(W) \
+  __atomic_load_n(&(W), __ATOMIC_RELAXED)
+#define HASHTABLE_STORE(W,V) \
+  __atomic_store_n(&(W), (V), __ATOMIC_RELAXED)
+
+void HashTableClear(_HashTable * t) {
+  memset(t->entries, 0,
+    t->nbuckets * HASHTABLE_BUCKET * sizeof(_HashEntry));
+  t->age = 0;
+  memset(&t->stats, 0, sizeof(_HashStats));
+}
+
+_HashTable * HashTable(size_t mb, Flag policy) {
+  //Largest power of 2 buckets that fits in "mb" MB
+  size_t bucket = HASHTABLE_BUCKET * sizeof(_HashEntry),
+    nbuckets = 1;
+  while(2 * nbuckets * bucket <= mb * 1024 * 1024)
+    nbuckets *= 2;
+
+  _HashTable * t = (_HashTable *) malloc(sizeof(_HashTable));
+  if(!t)
+    return NULL;
+  //Align buckets to cache lines (64 bytes)
+  t->memory = malloc(nbuckets * bucket + 64);
+  if(!t->memory) {
+    fprintf(stderr, "\nERROR: Cannot allocate hash table");
+    fflush(stderr);
+    free(t);
+    return NULL;
+  }
+  t->entries = (_HashEntry *)
+    (((uintptr_t) t->memory + 63) & ~((uintptr_t) 63));
+  t->nbuckets = nbuckets;
+  t->mask = nbuckets - 1;
+  t->policy = policy;
+  HashTableClear(t);
+  return t;
+}
+
+void HashTableDestroy(_HashTable * t) {
+  if(!t)
+    return;
+  free(t->memory);
+  free(t);
+}
+
+//Entries stored by the previous searches become "old"
+static inline void HashTableNewSearch(_HashTable * t) {
+  ++(t->age);
+}
+
+//Counters of a search (of a thread), after it's over
+void HashTableAddStats(_HashTable * t, _HashStats * stats) {
+  t->stats.probes += stats->probes;
+  t->stats.hits += stats->hits;
+  t->stats.stores += stats->stores;
+  t->stats.collisions += stats->collisions;
+}
+
+/* Look for the "key". If found, copy the entry to "entry" ..
+.. and return 1 */
+Flag HashTableProbe(_HashTable * t, uint64_t key,
+    _HashEntry * entry, _HashStats * stats) {
+  _HashEntry * e = &t->entries[(key & t->mask) * HASHTABLE_BUCKET];
+  if(stats)
+    ++(stats->probes);
+  for(int i=0; i<HASHTABLE_BUCKET; ++i, ++e) {
+    uint64_t check = HASHTABLE_LOAD(e->check), 
+      data = HASHTABLE_LOAD(e->data);
+    if((check ^ data) == key && 
+        HASH_BOUND(data) != HASHTABLE_NONE) {
+      entry->check = check;
+      entry->data = data;
+      if(stats)
+        ++(stats->hits);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void HashTableStore(_HashTable * t, uint64_t key, int depth,
+    Flag bound, int score, Move move, _HashStats * stats) {
+  _HashEntry * e = &t->entries[(key & t->mask) * HASHTABLE_BUCKET],
+    * replace = NULL;
+  uint64_t old = 0;
+  int worst = INT_MAX;
+  for(int i=0; i<HASHTABLE_BUCKET; ++i, ++e) {
+    uint64_t data = HASHTABLE_LOAD(e->data), 
+      check = HASHTABLE_LOAD(e->check);
+    if((check ^ data) == key) {
+      if(t->policy == HASHTABLE_DEPTH && bound != HASHTABLE_EXACT &&
+          HASH_AGE(data) == t->age && HASH_DEPTH(data) > depth)
+        return; //a deeper search of this position is kept
+      //Keep the old best move, if there is no new one
+      if(move == MOVE_NONE)
+        move = HASH_MOVE(data);
+      replace = e;
+      old = 0;
+      break;
+    }
+    //Empty entries first, then older ones, then shallower ones
+    int value = HASH_BOUND(data) == HASHTABLE_NONE ? INT_MIN :
+      HASH_DEPTH(data) - 256 * (uint8_t) (t->age - HASH_AGE(data));
+    if(value < worst) {
+      worst = value;
+      replace = e;
+      old = data;
+    }
+  }
+  if(stats) {
+    ++(stats->stores);
+    if(HASH_BOUND(old) != HASHTABLE_NONE)
+      ++(stats->collisions);
+  }
+  uint64_t data = HASH_DATA(move, score, depth, bound, t->age);
+  HASHTABLE_STORE(replace->check, key ^ data);
+  HASHTABLE_STORE(replace->data, data);
+}
+
+//Print the counters, and the occupancy (of first 1000 buckets)
+void HashTablePrintStats(_HashTable * t) {
+  size_t used = 0, n = t->nbuckets < 1000 ? t->nbuckets : 1000;
+  for(size_t i=0; i<n*HASHTABLE_BUCKET; ++i)
+    used += HASH_BOUND(HASHTABLE_LOAD(t->entries[i].data)) != 
+      HASHTABLE_NONE;
+  size_t probes = t->stats.probes, stores = t->stats.stores;
+  fprintf(stdout, "\nHashTable[%ld MB] : %ld probes, %.1f%% hits,"
+    " %ld stores, %.1f%% collisions, %.1f%% full",
+    (long) ((t->nbuckets * HASHTABLE_BUCKET * 
+      sizeof(_HashEntry)) >> 20),
+    (long) probes, 
+    probes ? 100.0 * t->stats.hits / probes : 0.0,
+    (long) stores,
+    stores ? 100.0 * t->stats.collisions / stores : 0.0,
+    100.0 * used / (n * HASHTABLE_BUCKET));
+  fflush(stdout);
+}
@@ -1,49 +1,147 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define MEMPOOL 
+#define MEMPOOL
 
 //random number < UINT32_MAX
-#define SAFETY_ENCODE 0xFBC9183 
+#define SAFETY_ENCODE 0xFBC9183
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  A pool of objects of the same size. The pool is a chain ..
+  .. of blocks of MEMPOOL_BLOCK_SIZE bytes (a power of 2). ..
+  .. A block is created only when every other block is ..
+  .. full, upto a ceiling of "maxblocks" blocks
+    _Mempool * pool = Mempool(object_size, nobjects);
+    void * obj = MempoolAllocateFrom(pool);
+    MempoolDeallocateTo(pool, obj);
+    MempoolFree(pool);
+  .. where "nobjects" is the ceiling (in no: of objects).
+  A block is aligned to its size, and starts with its ..
+  .. header (_MempoolBlock). So the block of an object is ..
+  .. just its address with the lower bits masked. A block ..
+  .. that becomes completely free is given back to the OS, ..
+  .. as long as the other blocks have some free slots left.
+  Blocks with a free slot are kept before the full ones, ..
+  .. so both allocation and deallocation are O(1).
+------------------------------------------------------------
+--------------------------------------------------------- */
+
+#ifndef MEMPOOL_BLOCK_SIZE
+#define MEMPOOL_BLOCK_SIZE (1024*1024)  //1 MB
+#endif
 
 // Define a struct for the free list node
 typedef struct _FreeNode {
   // Pointer to the next free slot
-  struct _FreeNode *next; 
+  struct _FreeNode *next;
 
-  /* while freeing, encode "safety" to SAFETY_ENCODE 
+  /* while freeing, encode "safety" to SAFETY_ENCODE
   .. to avoid double freeing of pool
   */
   uint32_t safety;
 }_FreeNode;
 
+// Header of a block (at the start of the block)
+typedef struct _MempoolBlock {
+  struct _Mempool * pool;       // owner (for sanity checks)
+  struct _MempoolBlock * next, * prev; // chain of blocks
+  _FreeNode * free_list; // Linked list of free slots
+  size_t nfree;          // No of freenodes in the block
+} _MempoolBlock;
+
 // Define the memory pool struct
 typedef struct _Mempool {
   size_t object_size;  // Size of each object
-  size_t block_size;   // Number of objects in the block
-  size_t nfree;   // No of freenodes in the block
-  void * memory_block;  // Pointer to the memory block
-  /* NOTE: Perfer making blocks that align with ..
-  .. multiples of kB or MB */
-  /* WARNING: There is no provision to know, if you,
-  .. deallocate same node multiple times */
-  _FreeNode * free_list; // Linked list of free slots
-
-  /* incase of a linked list of pool is reqd
-  struct _Mempool * next; 
-  */
+  size_t block_size;   // Size of a block in bytes
+  size_t nobjects;     // Number of objects in a block
+  size_t offset;       // Where objects start in a block
+  size_t maxblocks;    // Ceiling on the number of blocks
+  size_t nblocks;      // Blocks in use
+  size_t nfree;        // No of freenodes in all the blocks
+  /* High-water marks : max no: of objects allocated at a ..
+  .. time, and max no: of blocks */
+  size_t nused, maxused, maxnblocks;
+  /* Blocks with a free slot first, then the full ones */
+  _MempoolBlock * blocks, * last;
 } _Mempool;
 
+#define MEMPOOL_BLOCK_OF(pool, ptr)                 \
+  ((_MempoolBlock *) ((uintptr_t) (ptr) &            \
+    ~((uintptr_t) (pool)->block_size - 1)))
+
+//Move block "b" to the head (or to the tail) of the chain
+static void MempoolBlockUnlink(_Mempool * pool, _MempoolBlock * b) {
+  if(b->prev) b->prev->next = b->next; else pool->blocks = b->next;
+  if(b->next) b->next->prev = b->prev; else pool->last = b->prev;
+  b->next = b->prev = NULL;
+}
+
+static void MempoolBlockToHead(_Mempool * pool, _MempoolBlock * b) {
+  b->prev = NULL;
+  b->next = pool->blocks;
+  if(pool->blocks) pool->blocks->prev = b; else pool->last = b;
+  pool->blocks = b;
+}
+
+static void MempoolBlockToTail(_Mempool * pool, _MempoolBlock * b) {
+  b->next = NULL;
+  b->prev = pool->last;
+  if(pool->last) pool->last->next = b; else pool->blocks = b;
+  pool->last = b;
+}
+
+/* Create a new block (at the head of the chain), aligned ..
+.. to its size */
+static _MempoolBlock * MempoolBlock(_Mempool * pool) {
+  if(pool->nblocks >= pool->maxblocks)
+    return NULL;
+  void * memory = NULL;
+  if(posix_memalign(&memory, pool->block_size, pool->block_size)) {
+    fprintf(stderr, "\nERROR: \
+Failed to allocate memory block for the pool.");
+    fflush(stderr);
+    return NULL;
+  }
+  _MempoolBlock * b = (_MempoolBlock *) memory;
+  b->pool = pool;
+  b->nfree = pool->nobjects;
+
+  // Initialize the free list
+  b->free_list = NULL;
+  char * object = (char *) b + pool->offset +
+    (pool->nobjects - 1) * pool->object_size;
+  for (size_t i = 0; i < pool->nobjects;
+      i++, object -= pool->object_size) {
+    _FreeNode * node = (_FreeNode*) object;
+    node->next = b->free_list;
+    node->safety = SAFETY_ENCODE;
+    b->free_list = node;
+  }
+
+  MempoolBlockToHead(pool, b);
+  pool->nfree += pool->nobjects;
+  if(++(pool->nblocks) > pool->maxnblocks)
+    pool->maxnblocks = pool->nblocks;
+  return b;
+}
+
+static void MempoolBlockFree(_Mempool * pool, _MempoolBlock * b) {
+  MempoolBlockUnlink(pool, b);
+  pool->nfree -= b->nfree;
+  --(pool->nblocks);
+  free(b);
+}
+
 _Mempool* Mempool(size_t object_size, size_t nobjects) {
   // Initialize the memory pool
-  // FIXME: Redo this:
 
   if(object_size < sizeof (_FreeNode)){
     fprintf(stderr, "\nERROR: \
 Oject size should be atleast %ld ", sizeof(void *));
     // Otherwise you might overwrite when typecasting ..
-    // .. empty memspaces to _FreeNode * 
-    fflush(stderr);  
+    // .. empty memspaces to _FreeNode *
+    fflush(stderr);
     return NULL;
   }
   if(object_size%8) {
@@ -51,58 +149,57 @@ Oject size should be atleast %ld ", sizeof(void *));
 Prefer a multiple of 64 bit for object size. \
 Dicarding for the moment");
   }
-    
-  _Mempool * pool = 
+  //Objects start at a cache line after the header
+  size_t offset = (sizeof(_MempoolBlock) + 63) & ~((size_t) 63);
+  if(offset + object_size > MEMPOOL_BLOCK_SIZE) {
+    fprintf(stderr, "\nERROR: \
+Oject size should be less than a block");
+    fflush(stderr);
+    return NULL;
+  }
+
+  _Mempool * pool =
     (_Mempool*)malloc(sizeof(_Mempool));
   if (!pool) {
     fprintf(stderr, "\nERROR: \
 Failed to allocate memory for the pool.\n");
-    fflush(stderr);  
+    fflush(stderr);
     return NULL;
   }
 
-  size_t Bytes = nobjects * object_size,
-    kB = Bytes/1024, MB = Bytes/(1024*1024);
-  
-  //Rounding to closer kB , or MB
-  size_t block_size = kB < 1024 ? //less than an MB?
-    (kB+1)*1024 :  1024*1024; //1 MB is the limit
-  
-  size_t nfree = block_size/object_size;
-  
-  if(MB > 1) 
-    //1MB is the limit
-    fprintf(stderr, "\nWARNING: Block size rounded to 1MB");
-
   pool->object_size  = object_size;
-  pool->block_size   = block_size;
-  pool->nfree        = nfree;
-  pool->memory_block = malloc(block_size);
-  if (!pool->memory_block) {
-    fprintf(stderr, "\nERROR:\
-Failed to allocate memory block for the pool.");
+  pool->block_size   = MEMPOOL_BLOCK_SIZE;
+  pool->offset       = offset;
+  pool->nobjects     = (MEMPOOL_BLOCK_SIZE - offset)/object_size;
+  //Ceiling, rounded down to blocks (atleast one)
+  pool->maxblocks    = nobjects/pool->nobjects;
+  if(!pool->maxblocks)
+    pool->maxblocks  = 1;
+  pool->nblocks = pool->nfree = 0;
+  pool->nused = pool->maxused = pool->maxnblocks = 0;
+  pool->blocks = pool->last = NULL;
+
+  //First block is created right away
+  if(!MempoolBlock(pool)) {
     free(pool);
     return NULL;
   }
 
-  // Initialize the free list
-  pool->free_list = NULL;
-  char * block = (char *)  pool->memory_block;
-  for (size_t i = 0; i < nfree; i++,block+= object_size) {
-    _FreeNode * node = (_FreeNode*) block;
-    node->next = pool->free_list;
-    node->safety = SAFETY_ENCODE;
-    pool->free_list = node;
-  }
-
-  fprintf(stdout, "\nMemBlock[%ld bytes] created. \n\
+  fprintf(stdout, "\nMemPool[%ld x %ld bytes] created. \n\
 Can accomodate %ld Objects each of size %ld",
-pool->block_size, pool->nfree, pool->object_size);
+pool->maxblocks, pool->block_size,
+pool->maxblocks * pool->nobjects, pool->object_size);
   fflush(stdout);
 
   return pool;
 }
 
+// No: of objects that can still be allocated (upto ceiling)
+static inline size_t MempoolAvailability(_Mempool * pool) {
+  return pool->nfree +
+    (pool->maxblocks - pool->nblocks) * pool->nobjects;
+}
+
 // Allocate memory from the pool
 void * MempoolAllocateFrom(_Mempool * pool) {
   if (!pool){
@@ -110,7 +207,9 @@ void * MempoolAllocateFrom(_Mempool * pool) {
     fflush(stderr);
     return NULL;
   }
-  if (!pool->free_list) {
+  //Head of the chain is full, only if all the blocks are full
+  _MempoolBlock * b = pool->blocks;
+  if ((!b || !b->nfree) && !(b = MempoolBlock(pool))) {
     fprintf(stderr, "WARNING:\
 No free slots available in the pool.");
     fflush(stderr);
@@ -118,9 +217,14 @@ No free slots available in the pool.");
   }
 
   // Remove the first node from the free list
-  _FreeNode * node = pool->free_list;
-  pool->free_list = node->next;
+  _FreeNode * node = b->free_list;
+  b->free_list = node->next;
+  --(b->nfree);
   --(pool->nfree);
+  if(!b->nfree) {
+    MempoolBlockUnlink(pool, b);
+    MempoolBlockToTail(pool, b);
+  }
   if(node->safety != SAFETY_ENCODE)  {
     fprintf(stderr, "error:\
 double allocation of same memory pool address");
@@ -128,6 +232,8 @@ double allocation of same memory pool address");
     return NULL;
   }
   node->safety = 0;
+  if(++(pool->nused) > pool->maxused)
+    pool->maxused = pool->nused;
 
   return (void*) node;
 }
@@ -141,6 +247,14 @@ Either of pool or node NOT mentioned!");
     return;
   }
 
+  _MempoolBlock * b = MEMPOOL_BLOCK_OF(pool, ptr);
+  if(b->pool != pool) {
+    fprintf(stderr, "error:\
+address doesn't belong to the memory pool");
+    fflush(stderr);
+    return;
+  }
+
   // Add the slot back to the free list
   _FreeNode *node = (_FreeNode*)ptr;
   if(node->safety == SAFETY_ENCODE)  {
@@ -149,17 +263,37 @@ double freeing of memory pool");
     fflush(stderr);
     return;
   }
-  node->next = pool->free_list;
+  node->next = b->free_list;
   node->safety = SAFETY_ENCODE;
-  pool->free_list = node;
+  b->free_list = node;
   ++(pool->nfree);
+  --(pool->nused);
+  if(!(b->nfree)++) {
+    //Was full. Has a free slot now
+    MempoolBlockUnlink(pool, b);
+    MempoolBlockToHead(pool, b);
+  }
+  else if(b->nfree == pool->nobjects &&
+      pool->nfree - b->nfree >= pool->nobjects/2)
+    //Completely free, and the others have enough free slots
+    MempoolBlockFree(pool, b);
+}
+
+//Print the usage and the high-water marks
+void MempoolPrintStats(_Mempool * pool) {
+  fprintf(stdout, "\nMemPool : %ld/%ld objects in use (max %ld),"
+    " %ld/%ld blocks (max %ld)",
+    (long) pool->nused, (long) (pool->maxblocks * pool->nobjects),
+    (long) pool->maxused, (long) pool->nblocks,
+    (long) pool->maxblocks, (long) pool->maxnblocks);
+  fflush(stdout);
 }
 
 // Free the entire memory pool
 void MempoolFree(_Mempool *pool) {
   if (!pool) return;
 
-  free(pool->memory_block);
+  while(pool->blocks)
+    MempoolBlockFree(pool, pool->blocks);
   free(pool);
 }
-
@@ -19,105 +19,49 @@ When can a game draw:
   Draw by Time: A player's time runs out, but 
     their opponent cannot deliver checkmate.
 */
-static const char KNIGHT_MOVES[8] = 
-  { 14, 25, 23, 10, -14, -25, -23, -10 };
-static const char QUEEN_MOVES[8] =
-  { 1, 13, 12, 11, -1, -13, -12, -11 };
-static const char ROOK_MOVES[4] = 
-  { 1, 12, -1, -12 };
-static const char BISHOP_MOVES[4] = 
-  { 13, 11, -13, -11 };
-static const char WPAWN_MOVES[4] = 
-  { -11, -13, -12, -24 }; 
-static const char BPAWN_MOVES[4] = 
-  { 11, 13, 12, 24 };   
 
-static inline 
-Flag BoardIsAttackedByPiece ( Square * from, 
-    const char rays[], int nrays, int depth, 
-    Square * sq) {
-  //FIXME: remove;
-  //BoardMakeAvailable(b);
-
-  //'from' square can be neither empty nor outside the box
-  assert ( !IS_OUTSIDE(from) && !IS_EMPTY(from) );
-
-  for(int i=0; i<nrays; ++i) {
-    Square * to = from;
-    for(int j=0; j<depth; ++j) {
-      to += rays[i];
-      if(IS_OUTSIDE(to)) 
-        break; 
-      if(sq == to) {      //comparing pointers 
-        assert(!IS_BLOCKED (from,to));
-        //Making sure that the piece occupying "to" ..
-        // .. is not of the same color as the attacking piece 
-        return 1;       //yes, the square "sq" is attacked.
-      }
-      if(!IS_EMPTY(to))
-        break;          //Blocked by another piece
-    }
-  }
-  return 0; // the square "sq" is safe from an attack
-}
-
-Flag BoardIsAttackedByBPawn (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, BPAWN_MOVES, 2, 1, sq));
-}
-
-Flag BoardIsAttackedByWPawn (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, WPAWN_MOVES, 2, 1, sq));
-}
-
-Flag BoardIsAttackedByRook (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, ROOK_MOVES, 4, 7, sq));
-}
-
-Flag BoardIsAttackedByBishop (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, BISHOP_MOVES, 4, 7, sq));
-}
-
-Flag BoardIsAttackedByKnight (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, KNIGHT_MOVES, 8, 1, sq));
-}
-
-Flag BoardIsAttackedByQueen (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, QUEEN_MOVES, 8, 7, sq));
-}
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  A "MoveList" stores all the moves of a position in a ..
+  .. fixed size buffer (no known position has more than ..
+  .. 218 legal moves) as 16 bit "Move"s (refer board.h). ..
+  .. Generators write directly to ..
+  .. "list->moves[list->len++]", so there is neither an ..
+  .. allocation nor any shared state while generating ..
+  .. moves. Prefer keeping it on the stack.
+------------------------------------------------------------
+--------------------------------------------------------- */
+#define MOVELIST_MAX 256
 
-Flag BoardIsAttackedByKing (Square * from, Square * sq) {
-  return(BoardIsAttackedByPiece(from, QUEEN_MOVES, 8, 1, sq));
-}
+typedef struct {
+  Move moves[MOVELIST_MAX];
+  int len;                        // number of moves
+} MoveList;
 
-Flag (*BoardIsSquareAttackedByPiece [14])
-  (Square *from, Square * to) = { NULL, NULL, 
-    BoardIsAttackedByBPawn, BoardIsAttackedByWPawn, 
-    BoardIsAttackedByRook, BoardIsAttackedByRook,
-    BoardIsAttackedByKnight, BoardIsAttackedByKnight,
-    BoardIsAttackedByBishop, BoardIsAttackedByBishop,
-    BoardIsAttackedByQueen, BoardIsAttackedByQueen,
-    BoardIsAttackedByKing, BoardIsAttackedByKing 
-};
 /* ---------------------------------------------------------
 ------------------------------------------------------------
   The function
-    BoardIsSquareAttacked( g, sq , color);
+    BoardIsSquareAttacked( b, sq , color);
   .. check if the square "sq" is attacked by any piece of ..
   .. color "color".
-    BoardIsKingAttacked( g, color);
+    BoardIsKingAttacked( b, color);
   .. is used to see if the king of color "color" is under ..
   .. any attack. This function can be used to (1) see if ..
   .. a move is valid or not; and to (2) see if a move ..
   .. produces a check.
+  Instead of asking each piece if it can reach "sq", a ..
+  .. "super-piece" on "sq" radiates as a pawn, knight, ..
+  .. king, bishop and rook. Any piece of color "color" it ..
+  .. hits with its own kind of move is an attacker (attacks
+  .. are symmetric). Cheapest tests are done first and the ..
+  .. search stops at the first attacker found.
 ------------------------------------------------------------
 --------------------------------------------------------- */
 Flag BoardIsSquareAttacked(_Board * b, 
-    Square *sq, Flag attackingColor) {
+    Square s, Flag attackingColor) {
    
-  BoardMakeAvailable(b);
-  //Square * sq = SquarePointer(s);
-  if( !IS_EMPTY(sq) )
-    if( PIECE_COLOR(sq) == attackingColor ) {
+  if( b->pieces[s] != EMPTY )
+    if( (b->pieces[s] & 1) == attackingColor ) {
       // weird condition. This should't arise.
       // This condn arises when we are looking if 'sq' ..
       // .. occupied by a piece of color 'color' is being ..
@@ -128,24 +72,22 @@ Flag BoardIsSquareAttacked(_Board * b,
       assert(0);
     }
 
-  /*check if the square "sq" is attacked by ..
-  .. any pieces of color "color"*/
-  for (int i=0; i<8; ++i)
-    for(int j=0; j<8; ++j) {
-      //Replace it with square iterator
-      Square * from = &(GAMEBOARD[i][j]);
-      if( IS_EMPTY(from) )
-  continue; //empty
-      if( from == sq )
-	continue;
-      if( PIECE_COLOR(from) != attackingColor )
-  continue; //Occupied by the other color
-      //Generate possible moves with the 'piece' ..
-      // to see if 'piece' can attack 'sq'
-      Piece piece = SQUARE_PIECE(from); 
-      if(BoardIsSquareAttackedByPiece[piece](from, sq))
-  return 1; //Some piece attacks "sq"
-    }
+  Bitboard * bb = b->bitboard;
+  Flag c = attackingColor;
+  //A pawn of color 'c' attacks 's' from where a pawn of ..
+  // .. the other color on 's' would attack.
+  if( PAWN_ATTACKS[!c][s] & bb[BPAWN | c] )
+    return 1;
+  if( KNIGHT_ATTACKS[s] & bb[BKNIGHT | c] )
+    return 1;
+  if( KING_ATTACKS[s] & bb[BKING | c] )
+    return 1;
+  Bitboard occ = BoardOccupancy(b),
+    queens = bb[BQUEEN | c];
+  if( BitboardBishopAttacks(s, occ) & (bb[BBISHOP | c] | queens) )
+    return 1;
+  if( BitboardRookAttacks(s, occ) & (bb[BROOK | c] | queens) )
+    return 1;
 
   //Square "sq" is safe from any attack
   return 0;
@@ -155,248 +97,350 @@ Flag BoardIsSquareAttacked(_Board * b,
 Flag BoardIsKingAttacked(_Board * b, Flag color)  {
   /*check if the King of color "color" is attacked by ..
   .. any opponent piece */
-  Square * king = SquarePointer(b->king[color]);
-  return(BoardIsSquareAttacked(b, king, !color));
+  return(BoardIsSquareAttacked(b, b->king[color], !color));
 }
 
-Flag BoardIsMoveValid(_Board * b, _BoardMove * move) {
-
-    BoardMove(b, move);
-    Flag valid = !BoardIsKingAttacked(b, b->color);
-    if(valid)
-      if(BoardIsKingAttacked(b, !b->color))
-        move->flags |= MOVE_CHECK;
-    BoardUnmove(b, move);
-
-    return valid;
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Pins and checks of the current position. They are ..
+  .. computed once per position by 
+    BoardMoveInfo(b, &info);
+  .. so that the move generators below emit only legal ..
+  .. moves, without making each move and searching for ..
+  .. attacks on the king. (Whether a move gives a check is ..
+  .. known once it is made, from "b->check").
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef struct {
+  //Opponent pieces attacking the king of 'b->color'
+  Bitboard checkers;
+  //Own pieces which cannot leave the line to own king
+  Bitboard pinned;
+  //Allowed destinations for pieces other than king ..
+  // .. (any square not occupied by own piece if not in ..
+  // .. check; the checker or squares that block it if ..
+  // .. in a single check; none if double check)
+  Bitboard target;
+}_BoardMoveInfo;
+
+//All pieces (of both colors) that attack the square 's' ..
+// .. for a given occupancy 'occ'
+Bitboard BoardAttackersTo(_Board * b, Square s, Bitboard occ) {
+  Bitboard * bb = b->bitboard;
+  return 
+    (PAWN_ATTACKS[WHITE][s] & bb[BPAWN]) |
+    (PAWN_ATTACKS[BLACK][s] & bb[WPAWN]) |
+    (KNIGHT_ATTACKS[s] & (bb[BKNIGHT] | bb[WKNIGHT])) |
+    (KING_ATTACKS[s] & (bb[BKING] | bb[WKING])) |
+    (BitboardBishopAttacks(s, occ) & (bb[BBISHOP] | bb[WBISHOP] |
+      bb[BQUEEN] | bb[WQUEEN])) |
+    (BitboardRookAttacks(s, occ) & (bb[BROOK] | bb[WROOK] |
+      bb[BQUEEN] | bb[WQUEEN]));
 }
 
+//Pieces of color 'blockers' standing alone between the ..
+// .. square 's' and a slider of color 'sliders' aiming at 's'
 static inline 
-void BoardMovesFrom( Square * from, 
-    const char rays[], int nrays, int depth, 
-    Array * moves) {
-
-  //'from' square can be neither empty nor outside the box
-  assert ( !IS_OUTSIDE(from) && !IS_EMPTY(from) );
-
-  for(int i=0; i<nrays; ++i) {
-    Square * to = from;
-    for(int j=0; j<depth; ++j) {
-      to += rays[i];
-      // Cannot move along the ray, will end up outside board 
-      if(IS_OUTSIDE(to))
-        break; 
-      // Occupied by same color; 'break' moving along the ray
-      if(IS_BLOCKED(from, to))
-        break;
-      Flag flags = IS_EMPTY(to)  
-        ? MOVE_NORMAL : MOVE_CAPTURE;
-      //create a new array for moves if not already created; 
-      _BoardMove move = {
-        .from.piece = SQUARE_PIECE(from),
-        .from.square = *from,
-        .to.piece = SQUARE_PIECE(to),
-        .to.square = *to,
-        .promotion = EMPTY,
-        .flags = flags
-      };
-      //Add to the list of possible moves.
-      array_append( moves, &move, sizeof(move) );
-
-      // Cannot move further beyond a capture.
-      if(flags & MOVE_CAPTURE)
-        break;
-    }
+Bitboard BoardBlockers(_Board * b, Square s, Flag sliders, 
+    Flag blockers) {
+  Bitboard * bb = b->bitboard, occ = BoardOccupancy(b),
+    queens = bb[BQUEEN | sliders], pinned = 0;
+  Bitboard snipers = 
+    (BitboardRookAttacks(s, 0) & (bb[BROOK | sliders] | queens)) |
+    (BitboardBishopAttacks(s, 0) & (bb[BBISHOP | sliders] | queens));
+  while(snipers) {
+    Bitboard between = BETWEEN[s][BitboardPop(&snipers)] & occ;
+    if(between && !(between & (between - 1)))
+      //exactly one piece in between
+      pinned |= between & bb[blockers];
   }
+  return pinned;
 }
 
-void BoardQueenMoves(_Board *b, Square * from, Array * moves){
-  NOT_UNUSED(b);
-  BoardMovesFrom(from, QUEEN_MOVES, 8, 7, moves); 
+void BoardMoveInfo(_Board * b, _BoardMoveInfo * info) {
+  Flag us = b->color, them = !us;
+  Square king = b->king[us];
+  Bitboard occ = BoardOccupancy(b);
+
+  info->checkers = BoardAttackersTo(b, king, occ) & b->bitboard[them];
+  info->pinned = BoardBlockers(b, king, them, us);
+
+  if(!info->checkers) 
+    info->target = ~b->bitboard[us];
+  else if(info->checkers & (info->checkers - 1))
+    info->target = 0; //double check. only king can move
+  else
+    info->target = info->checkers | 
+      BETWEEN[king][BitboardFirst(info->checkers)];
+
 }
 
-void BoardKingMoves(_Board *b, Square * from, Array * moves){
-  BoardMovesFrom(from, QUEEN_MOVES, 8, 1, moves);
-  //Check for castling ability
-  if ( (MOVE_kCASTLE << b->color) & (b->castling) ) {
-    //King Side castling
-    Flag available = 1;
-    Square * king = &(GAMEBOARD[7*b->color][4]);
-    Square * rook = &(GAMEBOARD[7*b->color][7]);
-    assert(SQUARE_PIECE(king) == (BKING|b->color));
-    assert(SQUARE_PIECE(rook) == (BROOK|b->color));  
-    assert(king == from);
-    for(int i=1; i<3; ++i) {
-      Square * sq = king + i;
-      // see if 2 squares b/w king and rook are empty
-      if(!IS_EMPTY(sq)) {
-        available = 0;
-        break;
-      }
-    }
-    if(available) {
-      for(int i=0; i<4; ++i) {
-        // see if king, rook and the 2 squares in b/w them ..
-        // .. are under attack
-        if(BoardIsSquareAttacked (b, king + i, !b->color)) {
-          available = 0;
-          break;
-        }
-      }
-    }
-    
-    if(available) {
-      _BoardMove move = {
-        .from.piece = SQUARE_PIECE(king),
-        .from.square = *king,
-        .to.piece = EMPTY,
-        .to.square = 2 + *king,
-        .promotion = EMPTY,
-        .flags = MOVE_kCASTLE << b->color
-      };
-      array_append(moves,&move, sizeof(move));
-    }
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Material value (centipawns) of each piece, for ordering ..
+  .. and pruning of captures. Not an evaluation.
+    PIECE_VALUE[b->pieces[s]];
+  Piece captured by the move "m" (EMPTY for a quiet move)
+    BoardMoveCaptured(b, m);
+------------------------------------------------------------
+--------------------------------------------------------- */
+const int PIECE_VALUE[16] =
+  { 0, 0,
+    100, 100, 500, 500, 320, 320,
+    330, 330, 900, 900, 20000, 20000,
+    0, 0
+  };
+
+static inline Piece BoardMoveCaptured(_Board * b, Move m) {
+  return MOVE_SPECIAL(m) == MOVE_SPECIAL_ENPASSANTE ? 
+    (b->color == WHITE ? BPAWN : WPAWN) : b->pieces[MOVE_TO(m)];
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Static exchange evaluation (SEE). Material won (in ..
+  .. centipawns, from the point of view of the player to ..
+  .. move) by the capture "m" and the sequence of captures ..
+  .. on its destination square, each side recapturing with ..
+  .. its least valuable attacker, and stopping whenever ..
+  .. recapturing doesn't pay.
+    int gain = BoardSee(b, m);
+  Attackers hidden behind a capturer (x-rays) join as the ..
+  .. capturer leaves its square. Pins are ignored, but a ..
+  .. king doesn't capture a defended piece. Nothing is ..
+  .. searched, so it is cheap enough to order captures and ..
+  .. to prune the losing ones.
+  Refer
+    https://www.chessprogramming.org/Static_Exchange_Evaluation
+------------------------------------------------------------
+--------------------------------------------------------- */
+int BoardSee(_Board * b, Move m) {
+  Square from = MOVE_FROM(m), to = MOVE_TO(m);
+  if(MOVE_SPECIAL(m) == MOVE_SPECIAL_CASTLE)
+    return 0;
+  Bitboard * bb = b->bitboard, occ = BoardOccupancy(b) ^ BITBOARD(from),
+    diagonal = bb[BBISHOP] | bb[WBISHOP] | bb[BQUEEN] | bb[WQUEEN],
+    straight = bb[BROOK] | bb[WROOK] | bb[BQUEEN] | bb[WQUEEN];
+  //gain[d] : material won by the side making the d'th capture
+  int gain[32], d = 0, 
+    value = PIECE_VALUE[b->pieces[from]]; //piece on the square
+  gain[0] = PIECE_VALUE[BoardMoveCaptured(b, m)];
+  if(MOVE_SPECIAL(m) == MOVE_SPECIAL_ENPASSANTE)
+    occ ^= BITBOARD(b->color ? to + 8 : to - 8);
+  else if(MOVE_IS_PROMOTION(m)) {
+    value = PIECE_VALUE[MOVE_PROMOTED(m)];
+    gain[0] += value - PIECE_VALUE[BPAWN];
   }
-  if ( (MOVE_qCASTLE << b->color) & (b->castling) ) {
-    //Queen Side castling
-    Square * king = &(GAMEBOARD[7*b->color][4]);
-    Square * rook = &(GAMEBOARD[7*b->color][0]);
-    assert(SQUARE_PIECE(king) == (BKING|b->color));
-    assert(SQUARE_PIECE(rook) == (BROOK|b->color));  
-    assert(king == from);
-    Flag available = 1;
-    for(int i=-3; i<0; ++i) {
-      Square * sq = king + i;
-      // see if 2 squares b/w king and rook are empty
-      if(!IS_EMPTY(sq)) {
-        available = 0;
-        break;
-      }
-    }
-    if(available) {
-      for(int i=-4; i<1; ++i) {
-        // see if king, rook and the 3 squares in b/w them ..
-        // .. are under attack
-        if(BoardIsSquareAttacked (b, king + i, !b->color)) {
-          available = 0;
-          break;
-        }
-      }
-    }
-    
-    if(available) {
-      _BoardMove move = {
-        .from.piece = SQUARE_PIECE(king),
-        .from.square = *king,
-        .to.piece = EMPTY,
-        .to.square = -2 + *king,
-        .promotion = EMPTY,
-        .flags = MOVE_qCASTLE << b->color
-      };
-      array_append(moves,&move, sizeof(move));
+
+  //Least valuable first
+  const Piece order[6] = {BPAWN, BKNIGHT, BBISHOP, BROOK, BQUEEN, BKING};
+  Bitboard attackers = BoardAttackersTo(b, to, occ) & occ;
+  Flag side = !b->color;
+  while(d < 31) {
+    Bitboard own = attackers & bb[side], set = 0;
+    if(!own)
+      break;
+    Piece p = EMPTY;
+    for(int i=0; i<6 && !set; ++i) {
+      p = order[i] | side;
+      set = own & bb[p];
     }
+    Square sq = (Square) BitboardFirst(set);
+    occ ^= BITBOARD(sq);
+    attackers |= (BitboardBishopAttacks(to, occ) & diagonal) |
+      (BitboardRookAttacks(to, occ) & straight);
+    attackers &= occ;
+    //King can't capture a defended piece
+    if(p == (BKING | side) && (attackers & bb[!side]))
+      break;
+    ++d;
+    gain[d] = value - gain[d-1];
+    value = PIECE_VALUE[p];
+    side = !side;
   }
+  //A side may decline to capture
+  for(; d; --d)
+    gain[d-1] = -(gain[d] > -gain[d-1] ? gain[d] : -gain[d-1]);
+  return gain[0];
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Append a (legal) move to the list "moves".
+------------------------------------------------------------
+--------------------------------------------------------- */
+static inline 
+void BoardMoveAppend(Square from, Square to, Flag special,
+    MoveList * moves) {
+  assert(moves->len < MOVELIST_MAX);
+  moves->moves[moves->len++] = MOVE_PACK(from, to, special);
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Append a move from the square "from" to each square of ..
+  .. the bitboard "targets" (which shouldn't contain squares
+  .. occupied by the pieces of the same color).
+------------------------------------------------------------
+--------------------------------------------------------- */
+static inline 
+void BoardMovesTo( _Board * b, _BoardMoveInfo * info, Square from,
+    Bitboard targets, MoveList * moves) {
+
+  //'from' square cannot be empty
+  assert ( b->pieces[from] != EMPTY );
+  assert ( !(targets & b->bitboard[b->color]) );
+
+  //A pinned piece can only move along the pin 
+  if(BITBOARD_HAS(info->pinned, from))
+    targets &= LINE[b->king[b->color]][from];
+
+  //Add to the list of possible moves.
+  while(targets) 
+    BoardMoveAppend( from, (Square) BitboardPop(&targets), 
+      MOVE_SPECIAL_NORMAL, moves );
 }
 
-void BoardBishopMoves(_Board * b, Square * from, Array *moves){
-  NOT_UNUSED(b);
-  BoardMovesFrom(from, BISHOP_MOVES, 4, 7, moves); 
+void BoardQueenMoves(_Board *b, _BoardMoveInfo * info, Square from,
+    MoveList * moves){
+  BoardMovesTo(b, info, from, 
+    BitboardQueenAttacks(from, BoardOccupancy(b)) & info->target, 
+    moves); 
 }
 
-void BoardKnightMoves(_Board * b, Square * from, Array *moves){
-  NOT_UNUSED(b);
-  BoardMovesFrom(from, KNIGHT_MOVES, 8, 1, moves); 
+void BoardBishopMoves(_Board * b, _BoardMoveInfo * info, Square from,
+    MoveList * moves){
+  BoardMovesTo(b, info, from, 
+    BitboardBishopAttacks(from, BoardOccupancy(b)) & info->target, 
+    moves); 
 }
 
-void BoardRookMoves(_Board * b, Square * from, Array * moves){
-  NOT_UNUSED(b);
-  BoardMovesFrom(from, ROOK_MOVES, 4, 7, moves); 
+void BoardKnightMoves(_Board * b, _BoardMoveInfo * info, Square from,
+    MoveList * moves){
+  BoardMovesTo(b, info, from, KNIGHT_ATTACKS[from] & info->target,
+    moves); 
 }
 
-void BoardPawnMoves(_Board * b, Square * from, 
-  const char rays[], Array * moves)
-{
+void BoardRookMoves(_Board * b, _BoardMoveInfo * info, Square from,
+    MoveList * moves){
+  BoardMovesTo(b, info, from, 
+    BitboardRookAttacks(from, BoardOccupancy(b)) & info->target, 
+    moves); 
+}
 
-  for(int j=0; j<2; j++) {
-    //Diagonal advance of pawn
-    Square * to = from + rays[j];
-    Flag flags = IS_CAPTURE(from,to) ? 
-      MOVE_CAPTURE : IS_ENPASSANTE(from,to,b) ?
-      MOVE_ENPASSANTE : 0;
-  
-    //Pawn move diagonally only if it's a  ..
-    //.. capture or an "en-passante" capture
-    if(!flags) 
-      continue;
+void BoardKingMoves(_Board *b, _BoardMoveInfo * info, Square from,
+    MoveList * moves){
+  Flag us = b->color;
+  Bitboard occ = BoardOccupancy(b) ^ BITBOARD(from), 
+    targets = KING_ATTACKS[from] & ~b->bitboard[us], safe = 0;
+  //King cannot step into an attack. (Board occupancy ..
+  // .. excludes the king, so that it cannot hide behind ..
+  // .. itself along the line of a checking slider)
+  while(targets) {
+    Square to = (Square) BitboardPop(&targets);
+    if( !(BoardAttackersTo(b, to, occ) & b->bitboard[!us]) )
+      safe |= BITBOARD(to);
+  }
+  BoardMovesTo(b, info, from, safe, moves);
 
-    flags |= IS_PROMOTION(from, to) ? MOVE_PROMOTION : 0;
-
-    _BoardMove move = {
-      .from.piece = SQUARE_PIECE(from),
-      .from.square = *from,
-      .to.piece = SQUARE_PIECE(to),
-      .to.square = *to,
-      .promotion = EMPTY,
-      .flags = flags
-    };
-     
-    if(flags & MOVE_PROMOTION) {
-      move.promotion = SQUARE_PIECE(from);
-      for(int i=0; i<4; ++i) {
-        //'p' is promoted to 'r','b','n' and 'q'
-        move.promotion += 1 << PIECE_SHIFT; 
-        array_append (moves, &move, sizeof(move));
-      } 
-    }
-    else {
-      array_append (moves, &move, sizeof(move));
-    }
+  //No castling out of a check
+  if(info->checkers)
+    return;
   
-  }
-  //FIXME: can be made into :for(int j=0; j<4; ++j) {}
-  for(int j=2; j<4; j++) {
-    //vertical advance of pawn
-    unsigned char * to = from + rays[j];
-    if(!IS_EMPTY(to))
-      break; //capture, block, outside leads to "break"
-    Flag flags = MOVE_NORMAL;
-    flags |= IS_PROMOTION(from, to) ? MOVE_PROMOTION : 0;
-    _BoardMove move = {
-      .from.piece = SQUARE_PIECE(from),
-      .from.square = *from,
-      .to.piece = SQUARE_PIECE(to),
-      .to.square = *to,
-      .promotion = EMPTY,
-      .flags = flags
-    };
-    if(flags & MOVE_PROMOTION) {
-      move.promotion = SQUARE_PIECE(from);
-      for(int i=0; i<4; ++i) {
-        //'p' is promoted to 'r','b','n' and 'q'
-        move.promotion += 1 << PIECE_SHIFT; 
-        array_append (moves, &move, sizeof(move));
-      } 
-    }
-    else {
-      array_append (moves, &move, sizeof(move));
+  occ ^= BITBOARD(from);
+  for(int side=0; side<2; ++side) {
+    //side 0 : King side, side 1 : Queen side
+    Flag flag = (side ? MOVE_qCASTLE : MOVE_kCASTLE) << us;
+    if( !(flag & b->castling) ) 
+      continue;
+    Square king = 56*us + 4, rook = side ? king - 4 : king + 3;
+    int dir = side ? -1 : 1;
+    assert(from == king);
+    if(b->pieces[rook] != (BROOK | us))
+      continue;
+    // squares b/w king and rook are empty
+    if(BETWEEN[king][rook] & occ)
+      continue;
+    // squares crossed by the king are not under attack
+    Flag available = 1;
+    for(int i=1; i<3; ++i) {
+      Square sq = king + i*dir;
+      if(BoardIsSquareAttacked (b, sq, !us)) {
+        available = 0;
+        break;
+      }
     }
+    if(!available)
+      continue;
 
-    //double advance only for starting pawns
-    if( SQUARE_RANK(from) != (b->color ? '2' : '7') )
-      break;  
+    BoardMoveAppend(king, king + 2*dir, MOVE_SPECIAL_CASTLE, moves);
   }
 }
 
-void BoardBPawnMoves(_Board * b, Square * from, Array * moves){
-  BoardPawnMoves(b, from, BPAWN_MOVES, moves);
+//Append pawn move (or the 4 promotions) from 'from' to 'to'
+static inline 
+void BoardPawnMovesTo(Square from, Square to, MoveList * moves) {
+  if(to < 8 || to >= 56) {
+    for(Piece p = BROOK; p <= BQUEEN; p += 1 << PIECE_SHIFT) 
+      //'p' is promoted to 'r','n','b' and 'q'
+      BoardMoveAppend (from, to, MOVE_SPECIAL_PROMOTED(p), moves);
+  }
+  else
+    BoardMoveAppend (from, to, MOVE_SPECIAL_NORMAL, moves);
 }
 
-void BoardWPawnMoves(_Board * b, Square * from, Array * moves){
-  BoardPawnMoves(b, from, WPAWN_MOVES, moves);
+void BoardPawnMoves(_Board * b, _BoardMoveInfo * info, Square from,
+    MoveList * moves) {
+  Flag us = b->color;
+  int dir = us ? -8 : 8;
+  Bitboard occ = BoardOccupancy(b), allowed = info->target;
+  if(BITBOARD_HAS(info->pinned, from))
+    allowed &= LINE[b->king[us]][from];
+
+  //Diagonal advance of pawn only if it's a capture 
+  Bitboard captures = 
+    PAWN_ATTACKS[us][from] & b->bitboard[!us] & allowed;
+  while(captures) 
+    BoardPawnMovesTo(from, (Square) BitboardPop(&captures), moves);
+
+  //.. or an "en-passante" capture
+  Square ep = b->enpassante;
+  if(ep < OUTSIDE && BITBOARD_HAS(PAWN_ATTACKS[us][from], ep)) {
+    Square captured = ep - dir;
+    //Either it resolves the check (if any) ..
+    if( info->target & (BITBOARD(ep) | BITBOARD(captured)) ) {
+      //.. and the king is not exposed to a slider after ..
+      // .. both pawns leave their squares
+      Bitboard * bb = b->bitboard, 
+        after = (occ ^ BITBOARD(from) ^ BITBOARD(captured)) | 
+          BITBOARD(ep);
+      Square king = b->king[us];
+      Flag them = !us;
+      if( !(BitboardBishopAttacks(king, after) & 
+            (bb[BBISHOP | them] | bb[BQUEEN | them])) &&
+          !(BitboardRookAttacks(king, after) & 
+            (bb[BROOK | them] | bb[BQUEEN | them])) ) 
+        BoardMoveAppend(from, ep, MOVE_SPECIAL_ENPASSANTE, moves);
+    }
+  }
+
+  //vertical advance of pawn
+  Square to = from + dir;
+  if(BITBOARD_HAS(occ, to))
+    return; //blocked
+  if(BITBOARD_HAS(allowed, to))
+    BoardPawnMovesTo(from, to, moves);
+  //double advance only for starting pawns
+  if(from/8 != (us ? 6 : 1))
+    return;
+  to += dir;
+  if(!BITBOARD_HAS(occ, to) && BITBOARD_HAS(allowed, to))
+    BoardPawnMovesTo(from, to, moves);
 }
 
-void (*BoardPieceMoves[14]) (_Board *, Square *, Array * ) 
-  = { NULL, NULL, BoardBPawnMoves, BoardWPawnMoves, 
+void (*BoardPieceMoves[14]) (_Board *, _BoardMoveInfo *, Square,
+    MoveList * ) 
+  = { NULL, NULL, BoardPawnMoves, BoardPawnMoves, 
       BoardRookMoves, BoardRookMoves,
       BoardKnightMoves, BoardKnightMoves,
       BoardBishopMoves, BoardBishopMoves,
@@ -408,20 +452,91 @@ void (*BoardPieceMoves[14]) (_Board *, Square *, Array * )
   Functions that generate moves for each pieces . 
   Each Function pointers orresonding to each pieces ..
   .. can be called as 
-   BoardPieceMoves[from->piece](g, from);
-  The possible moves are appended to the array "b->moves".
-  NOTE: The moves generated include illegal moves ( or ..
-  .. those moves that allow the king on "attack" ). Those ..
-  .. moves will be later removed. For more, Read the function
-   BoardAllMoves(_Board * b);
+   BoardPieceMoves[piece](b, &info, from, moves);
+  The moves are appended to the list "moves".
+  All the legal moves of the board are listed by
+    BoardLegalMoves(b, &info, moves);
+  .. (only by the rules of moving. Doesn't look for a ..
+  .. draw/mate), while
+    BoardAllMoves(b, moves);
+  .. also updates the game status "b->status".
+  NOTE: Only legal moves are generated. Pinned pieces ..
+  .. stay on the line of the pin, and if the king is on ..
+  .. check, only the king moves, captures of the checker ..
+  .. and blocks are allowed (refer BoardMoveInfo()).
 ------------------------------------------------------------
 --------------------------------------------------------- */
 
-Flag BoardAllMoves(_Board * b, Array * moves){
+void BoardLegalMoves(_Board * b, _BoardMoveInfo * info, 
+    MoveList * moves){
+  moves->len = 0;
+  BoardMoveInfo(b, info);
+
+  //Iterate only through the squares occupied by 'b->color'. ..
+  // .. In a double check, only the king can move.
+  Bitboard own = info->target ? b->bitboard[b->color] : 
+    BITBOARD(b->king[b->color]);
+  while(own) {
+    Square from = (Square) BitboardPop(&own);
+    //Generate possible moves with the 'piece' 
+    BoardPieceMoves[b->pieces[from]](b, info, from, moves);
+  }
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Captures (including en-passante) and promotions only, ..
+  .. for the quiescence search.
+    BoardCaptureMoves(b, &info, moves);
+  The generators above are reused with the destinations ..
+  .. "info->target" narrowed to the opponent pieces. When ..
+  .. the king is in check, all the legal moves (evasions) ..
+  .. are listed instead, as a check cannot be ignored.
+------------------------------------------------------------
+--------------------------------------------------------- */
+void BoardCaptureMoves(_Board * b, _BoardMoveInfo * info, 
+    MoveList * moves){
+  moves->len = 0;
+  BoardMoveInfo(b, info);
+  if(info->checkers) {
+    BoardLegalMoves(b, info, moves);
+    return;
+  }
+
+  Flag us = b->color;
+  Square king = b->king[us];
+  Bitboard target = info->target, occ = BoardOccupancy(b),
+    own = b->bitboard[us] ^ BITBOARD(king);
+  info->target = b->bitboard[!us];
+  while(own) {
+    Square from = (Square) BitboardPop(&own);
+    Piece p = b->pieces[from];
+    BoardPieceMoves[p](b, info, from, moves);
+    //Promotion by a vertical advance (not a capture)
+    if(p == (BPAWN | us) && from/8 == (us ? 1 : 6)) {
+      Square to = us ? from - 8 : from + 8;
+      if(!BITBOARD_HAS(occ, to) && 
+          (!BITBOARD_HAS(info->pinned, from) || 
+          BITBOARD_HAS(LINE[king][from], to)))
+        BoardPawnMovesTo(from, to, moves);
+    }
+  }
+
+  //King captures only the undefended pieces
+  Bitboard targets = KING_ATTACKS[king] & info->target;
+  occ ^= BITBOARD(king);
+  while(targets) {
+    Square to = (Square) BitboardPop(&targets);
+    if( !(BoardAttackersTo(b, to, occ) & b->bitboard[!us]) )
+      BoardMoveAppend(king, to, MOVE_SPECIAL_NORMAL, moves);
+  }
+  info->target = target;
+}
+
+Flag BoardAllMoves(_Board * b, MoveList * moves){
 
   if(!moves)
     return GAME_STATUS_ERROR;
-  BoardMakeAvailable(b);
 
   /* Find all moves by rule*/ 
 
@@ -439,35 +554,12 @@ Flag BoardAllMoves(_Board * b, Array * moves){
     //Game over
     return b->status;
 
-  for (int i=0; i<8; ++i)
-    for(int j=0; j<8; ++j) {
-      Square * from = &(GAMEBOARD[i][j]);
-      if( IS_EMPTY(from) )
-  continue; //empty
-      if( PIECE_COLOR(from) != b->color )
-  continue; //Occupied by the other color
-      //Generate possible moves with the 'piece' 
-      BoardPieceMoves[SQUARE_PIECE(from)](b, from, moves);
-    }
-  
-  //Removing Invalid Moves
-  size_t smove = sizeof(_BoardMove);
-  int nmoves =  (int) (moves->len / smove);
-  _BoardMove * move = (_BoardMove *) (moves->p);
-  _BoardMove * m = move;
-  for(int i=0; i<nmoves; ++i, ++move) {
-    if(BoardIsMoveValid(b, move)) {
-      if(!(m == move)) //To avoid memcpy to same dest
-        memcpy(m, move, smove);
-      ++m;
-    }
-    else 
-      moves->len -= smove;
-  }
+  _BoardMoveInfo info;
+  BoardLegalMoves(b, &info, moves);
 
   //See if theBoard is over. Bcs no moves available
   if(!moves->len) {
-    b->status =  b->check ?     // was the board on check?
+    b->status =  info.checkers ?     // was the board on check?
       (GAME_IS_A_WIN | (!b->color)) : // then: someone wins 
       (GAME_IS_A_DRAW | GAME_STALEMATE); // otherwise:Stalemate
   } 
@@ -478,6 +570,10 @@ Flag BoardAllMoves(_Board * b, Array * moves){
 Flag
 BoardUpdateMetadata(_Board * b, _BoardMove * move) {
 
+  //Remove the keys of the old metadata from the hash.
+  b->hash ^= ZOBRIST_CASTLE(b->castling) ^ BoardHashEnpassante(b) ^
+    ZOBRIST_COLOR;
+
   //Udate the halfclock, fullclock
   if(!b->color)
     ++(b->fullclock);
@@ -486,8 +582,8 @@ BoardUpdateMetadata(_Board * b, _BoardMove * move) {
       ? 0 : (b->halfclock + 1));
   //Change the Turn
   b->color = !b->color;
-  //Is the board on Check?
-  b->check = move->flags & MOVE_CHECK;
+  //Is the board on Check? (MOVE_CHECK isn't part of a "Move")
+  b->check = BoardIsKingAttacked(b, b->color);
   //Set En-Passante square while double pawn advance
   if( move->from.piece == WPAWN &&
       (move->from.square - move->to.square == 16) ) 
@@ -516,6 +612,9 @@ BoardUpdateMetadata(_Board * b, _BoardMove * move) {
       b->castling &= ~MOVE_KCASTLE;
   }
 
+  //.. and add the keys of the new metadata.
+  b->hash ^= ZOBRIST_CASTLE(b->castling) ^ BoardHashEnpassante(b);
+
   //Total number of pieces
   if(move->flags & MOVE_CAPTURE)
     --(b->npieces);
@@ -527,19 +626,21 @@ BoardUpdateMetadata(_Board * b, _BoardMove * move) {
 }
 
 Flag  
-BoardNext(_Board * b, _BoardMove * move, Array * moves){
+BoardNext(_Board * b, Move m, MoveList * moves){
 
-  if(!move) {
+  if(m == MOVE_NONE) {
     fprintf(stderr, "\nERROR: Move not chosen");
     fprintf(stderr, "\nProbably loaded game is over");
     fflush(stdout);
     return GAME_STATUS_ERROR; //Game Stopped
   }
 
+  _BoardMove move;
+  BoardMoveDecode(b, m, &move);
   //Move the bitboard 
-  BoardMove(b, move); 
+  BoardMove(b, &move); 
   //Update the associated metadata of the board
-  if ( BoardUpdateMetadata(b, move) == GAME_STATUS_ERROR )
+  if ( BoardUpdateMetadata(b, &move) == GAME_STATUS_ERROR )
     return GAME_STATUS_ERROR;
     
  
@@ -547,6 +648,139 @@ BoardNext(_Board * b, _BoardMove * move, Array * moves){
   return(BoardAllMoves(b, moves));
 }
 
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Make and unmake a move on the same board, without ..
+  .. copying the board.
+    _BoardUndo undo;
+    BoardMakeMove(b, m, &undo);
+    ...
+    BoardUndoMove(b, m, &undo);
+  "undo" stores only the metadata that BoardUnmove() ..
+  .. cannot deduce from the move, so that the board ..
+  .. (including clocks, castling, en-passante, hash and ..
+  .. status) ..
+  .. is restored exactly. Make/Undo pairs can be nested ..
+  .. (with an undo per ply) for a depth first search.
+  NOTE: BoardMakeMove() doesn't generate moves (status ..
+  .. is GAME_STATUS_NOTUPDATED). Call BoardAllMoves() if ..
+  .. required.
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef struct {
+  Piece captured;   //EMPTY if not a capture (or en-passante)
+  Square enpassante;
+  Flag castling, check, status;
+  uint16_t halfclock, fullclock, npieces;
+  uint64_t hash;
+}_BoardUndo;
+
+Flag BoardMakeMove(_Board * b, Move m, _BoardUndo * undo) {
+  _BoardMove move;
+  BoardMoveDecode(b, m, &move);
+
+  undo->captured = move.to.piece;
+  undo->enpassante = b->enpassante;
+  undo->castling = b->castling;
+  undo->check = b->check;
+  undo->status = b->status;
+  undo->halfclock = b->halfclock;
+  undo->fullclock = b->fullclock;
+  undo->npieces = b->npieces;
+  undo->hash = b->hash;
+
+  //BoardUpdateMetadata() expects a board with known status
+  b->status = GAME_CONTINUE;
+  BoardMove(b, &move);
+  return BoardUpdateMetadata(b, &move);
+}
+
+void BoardUndoMove(_Board * b, Move m, _BoardUndo * undo) {
+  Square from = MOVE_FROM(m), to = MOVE_TO(m);
+  Flag special = MOVE_SPECIAL(m);
+  //It was the opponent's turn to move
+  b->color = !b->color;
+
+  //Reconstruct the _BoardMove from the board after the move.
+  _BoardMove move = {
+    .from.piece = special >= MOVE_SPECIAL_PROMOTION ? 
+      (BPAWN | b->color) : b->pieces[to],
+    .from.square = from,
+    .to.piece = undo->captured,
+    .to.square = to,
+    .promotion = special >= MOVE_SPECIAL_PROMOTION ? 
+      b->pieces[to] : EMPTY,
+    .flags = special == MOVE_SPECIAL_ENPASSANTE ? MOVE_ENPASSANTE :
+      special == MOVE_SPECIAL_CASTLE ? 
+        (to > from ? MOVE_kCASTLE : MOVE_qCASTLE) << b->color :
+      special >= MOVE_SPECIAL_PROMOTION ? MOVE_PROMOTION : 
+        MOVE_NORMAL
+  };
+  BoardUnmove(b, &move);
+
+  b->enpassante = undo->enpassante;
+  b->castling = undo->castling;
+  b->check = undo->check;
+  b->status = undo->status;
+  b->halfclock = undo->halfclock;
+  b->fullclock = undo->fullclock;
+  b->npieces = undo->npieces;
+  b->hash = undo->hash;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Null move : the player to move passes the turn. Not a ..
+  .. legal move (and never played in a game), but searched ..
+  .. by the engine to see if the opponent can harm even ..
+  .. with two moves in a row (null move pruning).
+    BoardMakeNullMove(b, &undo);
+    BoardUndoNullMove(b, &undo);
+  The king of the player to move shouldn't be in check.
+    BoardHasPieces(b, color);
+  .. tells if "color" has any piece other than pawns and ..
+  .. king. Else, passing the turn may be the best (zugzwang) ..
+  .. and the null move is meaningless.
+------------------------------------------------------------
+--------------------------------------------------------- */
+void BoardMakeNullMove(_Board * b, _BoardUndo * undo) {
+  assert(!b->check);
+  undo->captured = EMPTY;
+  undo->enpassante = b->enpassante;
+  undo->castling = b->castling;
+  undo->check = b->check;
+  undo->status = b->status;
+  undo->halfclock = b->halfclock;
+  undo->fullclock = b->fullclock;
+  undo->npieces = b->npieces;
+  undo->hash = b->hash;
+
+  b->hash ^= BoardHashEnpassante(b) ^ ZOBRIST_COLOR;
+  b->enpassante = OUTSIDE+1;
+  if(!b->color)
+    ++(b->fullclock);
+  ++(b->halfclock);
+  b->color = !b->color;
+  b->status = GAME_STATUS_NOTUPDATED;
+}
+
+void BoardUndoNullMove(_Board * b, _BoardUndo * undo) {
+  b->color = !b->color;
+  b->enpassante = undo->enpassante;
+  b->castling = undo->castling;
+  b->check = undo->check;
+  b->status = undo->status;
+  b->halfclock = undo->halfclock;
+  b->fullclock = undo->fullclock;
+  b->npieces = undo->npieces;
+  b->hash = undo->hash;
+}
+
+static inline Flag BoardHasPieces(_Board * b, Flag color) {
+  Bitboard * bb = b->bitboard;
+  return (bb[color] & ~bb[BPAWN | color] & ~bb[BKING | color]) != 0;
+}
+
 void BoardStatusPrint(_Board * b) {
   Flag f = b->status;
   if(f == GAME_CONTINUE) {
@@ -1,5 +1,6 @@
 #include "move.h"
 #include "mempool.h"
+#include <pthread.h>
 
 /**
 TODO: mempool for board and moves. Cap a limit too the pool.
@@ -26,11 +27,14 @@ typedef struct _Tree {
   _Board board;
   
   //which 'move' from last board resulted this board
-  _BoardMove move;
+  Move move;
 
   //Tree Connection using pointers
   struct _Tree * parent;   //parent node
   struct _Tree ** children; //children
+  //Root node : previous root retained for an undo (refer ..
+  // .. TreePrev()). "prev" still has this node as a child
+  struct _Tree * prev;
                           
   Flag depth, depthmax;   // depth <= depthmax
   // depthmax is the max allowed depth. 
@@ -46,17 +50,26 @@ typedef struct _Tree {
   //size_t unique;
 } _Tree;
 
+/* Memory budget (in MB) of the nodes of all the trees. ..
+.. The pool grows (block by block) upto this, so the depth ..
+.. a tree can be expanded to (before nodes are pruned) is ..
+.. limited only by the budget. Set before the first tree */
+#ifndef TREE_MEMORY_MB
+#define TREE_MEMORY_MB 64
+#endif
+size_t TREE_MEMORY = TREE_MEMORY_MB;
+
 _Mempool * TreePool = NULL;
 
+//No: of nodes that can still be created (upto the budget)
 static inline size_t TreeAvailability(){
-  return TreePool->nfree;
+  return MempoolAvailability(TreePool);
 }
 
 _Tree * TreeFromPool() {
   if(!TreePool) {
     TreePool = 
-      Mempool(sizeof(_Tree), 1 + 1024*1024/sizeof(_Tree)); 
-      //1MB  guaranteed
+      Mempool(sizeof(_Tree), TREE_MEMORY*1024*1024/sizeof(_Tree)); 
     fprintf(stdout, "\nTreePool avilability %ld", 
       TreeAvailability()); 
     fflush(stdout);
@@ -77,6 +90,24 @@ void TreeToPool(_Tree * tree) {
 #ifndef TREE_MIN_DEPTH
 #define TREE_MIN_DEPTH 2 
 #endif
+//Number of previous roots retained for undo
+#ifndef TREE_HISTORY
+#define TREE_HISTORY 4
+#endif
+
+/* Least budget (in MB) for a tree of TREE_MIN_DEPTH and ..
+.. TREE_HISTORY retained roots (each as large as the tree), ..
+.. with TREE_BRANCHING moves in a position, as is typical */
+#ifndef TREE_BRANCHING
+#define TREE_BRANCHING 40
+#endif
+size_t TreeMemoryMin() {
+  size_t nodes = 0, level = 1;
+  for(int d=0; d<=TREE_MIN_DEPTH; ++d, level *= TREE_BRANCHING)
+    nodes += level;
+  nodes *= 1 + TREE_HISTORY;
+  return (nodes * sizeof(_Tree) + 1024*1024 - 1)/(1024*1024);
+}
 
 enum TREE_NODE_FLAG {
   IS_LEAF_NODE = 1,
@@ -85,9 +116,6 @@ enum TREE_NODE_FLAG {
   //IS_NODE_ORIGINAL = 16,
   IS_PRUNED_NODE = 32
 };
-/* NOTE: if using this array 
-.. switch of multithreading if any */
-Array MOVES_ARRAY = {.p = NULL, .len = 0, .max = 0};
 
 /* ---------------------------------------------------------
 ------------------------------------------------------------
@@ -107,15 +135,15 @@ void TreeRootNode(_Tree * root, _Board * b, Flag depthmax) {
   // Tree connection
   root->parent = NULL;
   root->children = NULL;
+  root->prev = NULL;
   // create new board & copy content from 'b'
   //root->board = Board(b); 
   BoardCopy(&root->board, b);
 }
 
-void TreeChildNode(_Tree * child, _Tree * parent, 
-    _BoardMove * move) {
+void TreeChildNode(_Tree * child, _Tree * parent, Move m) {
 
-  assert(parent && move);
+  assert(parent && m != MOVE_NONE);
   assert(parent->board.status == GAME_CONTINUE);
 
   child->depth = 0;
@@ -126,13 +154,14 @@ void TreeChildNode(_Tree * child, _Tree * parent,
   //Tree connectivity
   child->parent = parent;
   child->children = NULL;
+  child->prev = NULL;
   //Which baord move resulted in 'child'
-  memcpy(&child->move, move, sizeof(_BoardMove));
+  child->move = m;
   //Create the board of the child.
   _Board * board = &child->board;
+  _BoardUndo undo;
   BoardCopy(board, &parent->board);
-  BoardMove(board, move);
-  BoardUpdateMetadata(board, move); 
+  BoardMakeMove(board, m, &undo);
   //NOTE:Status not updated yet. Moves not created
 }
 
@@ -175,8 +204,9 @@ Flag TreeNodeExpand(_Tree * node) {
   //assert( node->board->status == GAME_STATUS_NOTUPDATED );
 
   _Board * b = &(node->board);
+  MoveList moves;
   // Once moves created, status is also updated.
-  BoardAllMoves( b, &MOVES_ARRAY );
+  BoardAllMoves( b, &moves );
   
   if( b->status != GAME_CONTINUE ) {
     return 0; // cannot expand as the game is over
@@ -185,9 +215,9 @@ Flag TreeNodeExpand(_Tree * node) {
     return 0; // cannot expand bcs of tree depth limit
   }
 
-  assert(MOVES_ARRAY.len);
-  _BoardMove * move = (_BoardMove *) (MOVES_ARRAY.p);
-  Flag nmoves = (Flag) (MOVES_ARRAY.len/sizeof(_BoardMove));
+  assert(moves.len);
+  Move * move = moves.moves;
+  Flag nmoves = (Flag) moves.len;
   if( TreeAvailability() < (size_t) nmoves) {
     //fprintf(stderr, "OoM");
     //fprintf(stderr, "\nWARNING: Ran out of Tree Memory Block");
@@ -206,7 +236,7 @@ Flag TreeNodeExpand(_Tree * node) {
   for (int i=0; i<nmoves; ++i, ++children, ++move) {
     *children = TreeFromPool();
     assert(*children);
-    TreeChildNode(*children, node, move);
+    TreeChildNode(*children, node, *move);
   }
  
   // In case children are at max depth
@@ -216,8 +246,8 @@ Flag TreeNodeExpand(_Tree * node) {
     if(child->depthmax == 0)  
       // If not allowed to expand further, update the ..
       // .. board->status by calling BoardAllMoves();
-      //if(!BoardAllMoves(child->board, &MOVES_ARRAY))
-      if(!BoardAllMoves(&child->board, &MOVES_ARRAY))
+      //if(!BoardAllMoves(child->board, &moves))
+      if(!BoardAllMoves(&child->board, &moves))
         //i.e (status == GAME_CONTINUE)
         child->flags |= IS_PRUNED_NODE;
       // else 
@@ -438,6 +468,114 @@ void TreeEachNodePostOrder(_Tree * root, Flag searchDepth,
   free(rootParent);
 }
 
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Background tree worker. TreeNext() only re-roots the ..
+  .. tree and returns. The slow parts, i.e destroying the ..
+  .. roots dropped from the history and expanding the new ..
+  .. root to the max-depth, are posted as jobs
+    TreePost(tree, TREE_JOB_DESTROY | TREE_JOB_EXPAND);
+  .. to a single worker thread (started on the first job), ..
+  .. which runs them in order. The worker is the only one ..
+  .. touching the trees (and the TreePool) while a job is ..
+  .. pending. So, any other access to a tree waits for it
+    TreeWait();
+  .. which is done by Tree(), TreeNext(), TreePrev(), ..
+  .. TreeDestroy() and TreeDebug(). Reading the board of ..
+  .. the root is safe without waiting. If the thread cannot ..
+  .. be created, jobs are run by the caller itself.
+------------------------------------------------------------
+--------------------------------------------------------- */
+enum TREE_JOB {
+  TREE_JOB_DESTROY = 0,
+  TREE_JOB_EXPAND  = 1
+};
+
+#ifndef TREE_JOBS
+#define TREE_JOBS 16
+#endif
+
+typedef struct {
+  _Tree * tree;
+  Flag job;
+} _TreeJob;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;   //signalled on a new job, or a finished one
+  pthread_t thread;
+  Flag started, busy;
+  _TreeJob jobs[TREE_JOBS];
+  int head, len;         //circular queue
+} _TreeWorker;
+
+_TreeWorker TREE_WORKER = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER
+};
+
+void TreeDestroy(_Tree * tree);
+
+static void TreeRunJob(_TreeJob * job) {
+  _Tree * tree = job->tree;
+  if(job->job == TREE_JOB_DESTROY)
+    TreeDestroy(tree);
+  else 
+    TreeEachNode(tree, tree->depthmax - 1, TreeNodeExpand);
+}
+
+static void * TreeWorkerLoop(void * arg) {
+  _TreeWorker * w = (_TreeWorker *) arg;
+  pthread_mutex_lock(&w->lock);
+  while(1) {
+    while(!w->len)
+      pthread_cond_wait(&w->cond, &w->lock);
+    _TreeJob job = w->jobs[w->head];
+    w->head = (w->head + 1) % TREE_JOBS;
+    --(w->len);
+    w->busy = 1;
+    pthread_mutex_unlock(&w->lock);
+    TreeRunJob(&job);
+    pthread_mutex_lock(&w->lock);
+    w->busy = 0;
+    pthread_cond_broadcast(&w->cond);
+  }
+  return NULL;
+}
+
+//Wait till all the posted jobs are done
+void TreeWait() {
+  _TreeWorker * w = &TREE_WORKER;
+  pthread_mutex_lock(&w->lock);
+  //The worker itself never waits (TreeDestroy() from a job)
+  if(w->started && !pthread_equal(pthread_self(), w->thread))
+    while(w->len || w->busy)
+      pthread_cond_wait(&w->cond, &w->lock);
+  pthread_mutex_unlock(&w->lock);
+}
+
+void TreePost(_Tree * tree, Flag job) {
+  _TreeWorker * w = &TREE_WORKER;
+  _TreeJob j = {tree, job};
+  pthread_mutex_lock(&w->lock);
+  if(!w->started && 
+      !pthread_create(&w->thread, NULL, TreeWorkerLoop, w)) {
+    pthread_detach(w->thread);
+    w->started = 1;
+  }
+  if(!w->started || w->len == TREE_JOBS) {
+    //No worker (or the queue is full) : do it here
+    pthread_mutex_unlock(&w->lock);
+    TreeWait();
+    TreeRunJob(&j);
+    return;
+  }
+  w->jobs[(w->head + w->len) % TREE_JOBS] = j;
+  ++(w->len);
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+}
+
 /* ---------------------------------------------------------
 ------------------------------------------------------------
   Create a tree from a given instance of game 
@@ -455,6 +593,7 @@ _Tree * Tree(_Board * b, Flag depthmax) {
     return NULL;
   }
 
+  TreeWait();
 #if 1
   _Tree * root = TreeFromPool();
   if(!root) 
@@ -478,7 +617,13 @@ _Tree * Tree(_Board * b, Flag depthmax) {
   return root;
 }
 
+void TreeDestroyHistory(_Tree * root);
+
 void TreeDestroy(_Tree * tree) { 
+  TreeWait();
+  //Previous roots retained for undo (if any) go too
+  if(tree->prev)
+    TreeDestroyHistory(tree);
 
   //  You can prune the entire tree in one go using ..
   //  .. DFS - (post order) traversal
@@ -495,6 +640,71 @@ void TreeDestroy(_Tree * tree) {
 
 }
 
+//Remove "child" (without destroying it) from the children of "node"
+void TreeDetachChild(_Tree * node, _Tree * child) {
+  for(Flag i=0; i<node->nchildren; ++i) 
+    if(node->children[i] == child) {
+      node->children[i] = node->children[node->nchildren - 1];
+      node->children[node->nchildren - 1] = NULL;
+      --(node->nchildren);
+      break;
+    }
+  if(!node->nchildren && node->children) { 
+    node->depth = 1;
+    TreeNodePrune(node);
+  }
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Moving the root. Once a move is made (by player/opponent)
+    root = TreeNext(root, ichild);
+  .. the child "ichild" becomes the root and is expanded to ..
+  .. the max-depth. The old root is not destroyed, but ..
+  .. retained (with the subtrees of the other moves) as ..
+  .. "root->prev", so that an undo
+    root = TreePrev(root, board);
+  .. just moves the root back to the retained one (the ..
+  .. levels of the undone root, beyond the max-depth, are ..
+  .. pruned), keeping the nodes and their evaluations. Only ..
+  .. TREE_HISTORY previous roots are retained. Older ones ..
+  .. (or all, by TreeDestroyHistory()) are destroyed.
+  TreeNext() returns as soon as the root is moved. Older ..
+  .. roots are destroyed, and the new root is expanded, by ..
+  .. the background tree worker (refer TreePost()).
+------------------------------------------------------------
+--------------------------------------------------------- */
+void TreeDestroyHistory(_Tree * root) {
+  _Tree * r = root->prev;
+  root->prev = NULL;
+  if(r)
+    TreeDetachChild(r, root);
+  while(r) {
+    _Tree * older = r->prev;
+    r->prev = NULL;
+    if(older)
+      TreeDetachChild(older, r);
+    TreeDestroy(r);
+    r = older;
+  }
+}
+
+/* Destroy the oldest root retained before 'root'. The last ..
+.. one is 'root->prev' itself, i.e the siblings of 'root'. ..
+.. Returns 0, if there is none */
+static Flag TreeDropOldest(_Tree * root) {
+  if(!root->prev)
+    return 0;
+  _Tree * r = root;
+  while(r->prev->prev)
+    r = r->prev;
+  _Tree * old = r->prev;
+  r->prev = NULL;
+  TreeDetachChild(old, r);
+  TreeDestroy(old);
+  return 1;
+}
+
 _Tree * TreeNext(_Tree * root, Flag ichild) {
   /* Once a move is made, by player/opponent,
   .. Tree has to be updated.  */
@@ -503,6 +713,9 @@ _Tree * TreeNext(_Tree * root, Flag ichild) {
     return NULL;
   }
 
+  //Jobs of the last move (if any) are over
+  TreeWait();
+
   _Tree * next = ichild >= root->nchildren ? NULL :
     root->children[ichild];    
 
@@ -515,40 +728,77 @@ _Tree * TreeNext(_Tree * root, Flag ichild) {
   next->flags |= IS_ROOT_NODE;
   next->parent = NULL;
 
-  /* remove next from the subtree of 'tree' */
-  root->children[ichild] = root->children[root->nchildren - 1];
-  root->children[root->nchildren - 1] = NULL;
-  --(root->nchildren);
-  if(!root->nchildren) { 
-    root->depth = 1;
-    TreeNodePrune(root);
+  /* The first level of 'next' is expanded here, so that ..
+  .. the board (and the children) of the root are never ..
+  .. written by the worker. It is done before any job is ..
+  .. posted, as the TreePool is not shared with the worker */
+  next->prev = root;
+  /* The retained roots hold on to nodes. If the budget of ..
+  .. the pool is over, drop them (oldest first) till the ..
+  .. moves of 'next' fit in */
+  while(next->flags & IS_LEAF_NODE && !TreeNodeExpand(next) &&
+      next->board.status == GAME_CONTINUE && next->depthmax &&
+      TreeDropOldest(next));
+
+  /* 'root' is retained for an undo. Only TREE_HISTORY ..
+  .. of them */
+  _Tree * r = next;
+  for(int i=0; i<TREE_HISTORY && r->prev; ++i)
+    r = r->prev;
+  _Tree * old = r->prev;
+  if(old) {
+    //Detach the older history and leave it to the worker
+    r->prev = NULL;
+    TreeDetachChild(old, r);
+    TreePost(old, TREE_JOB_DESTROY);
   }
-  /* destroy 'root' */
-  TreeDestroy(root); 
 
-  /* Expand 'next' to the max-depth */
-  TreeEachNode(next, next->depthmax - 1, TreeNodeExpand);
+  /* Expand 'next' to the max-depth (in the background). ..
+  .. No tree access from here on */
+  TreePost(next, TREE_JOB_EXPAND);
 
   /* 'next' is the new 'root' node*/
   return next;
 }
 
+//Prune a node (with children) which is at the max-depth
+static Flag TreeNodeTrim(_Tree * node) {
+  if(node->depthmax == 0 && node->depth == 1)
+    return TreeNodePrune(node);
+  return 0;
+}
+
 _Tree * TreePrev(_Tree * root, _Board * board) {
   /* when undo a move, by player/opponent,
   .. Tree has to be updated.  */
+  TreeWait();
   if(!(root->flags & IS_ROOT_NODE)) {
     GameError("TreePrev() : Only root node allowed"); 
     return NULL;
   }
 
-  // TODO: fix this. 
-  // You shouldn't delete the existing tree completely
+  _Tree * prev = root->prev;
+  if(prev && prev->board.hash == board->hash) {
+    //"root" is a child of "prev" again
+    root->prev = NULL;
+    root->parent = prev;
+    root->flags &= ~IS_ROOT_NODE;
+    root->depthmax = prev->depthmax - 1;
+    //"root" was expanded one level deeper as a root
+    TreeEachNodePostOrder(root, root->depthmax, TreeNodeTrim);
+    prev->depth = 0;
+    for(Flag i=0; i<prev->nchildren; ++i)
+      if(prev->children[i]->depth >= prev->depth)
+        prev->depth = prev->children[i]->depth + 1;
+    return prev;
+  }
+
+  //No retained root. Rebuild the tree
   Flag depthmax = root->depthmax;
   TreeDestroy(root);
   return Tree(board, depthmax); 
 }
 
-
 /* Debugging tree */
 Flag TreeNodeCheckFlags(_Tree * node) {
   /* For debugging */
@@ -596,5 +846,6 @@ Flag TreeNodeCheckFlags(_Tree * node) {
 }
 
 void TreeDebug(_Tree * root) {
+  TreeWait();
   TreeEachNode(root, root->depth, TreeNodeCheckFlags);
 }
@@ -7,6 +7,8 @@
 .. (3) Optimized tree data structure. (minimal and aligned).
 .. (4) Tree search even if out of treepool memory.
 */
+//posix_memalign() (mempool.h), clock_gettime() (engine.h) in C99
+#define _POSIX_C_SOURCE 200112L
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -181,8 +183,37 @@ int is_port_available(int port)
  * unless if invoked from a different thread.
  */
 
-int main(void)
+int main(int argc, char ** argv)
 {
+  // Options
+  //   -H <MB> : size of the transposition table of the engine
+  //   -t <N>  : number of search threads of the engine
+  //   -p      : pondering (search on the opponent's time)
+  //   -M <MB> : memory budget of the game trees
+  for(int i=1; i<argc; ++i) {
+    if(!strcmp(argv[i], "-H") && i+1 < argc && 
+        atol(argv[i+1]) > 0)
+      ENGINE_HASH_SIZE = (size_t) atol(argv[++i]);
+    else if(!strcmp(argv[i], "-t") && i+1 < argc && 
+        atoi(argv[i+1]) > 0)
+      ENGINE_THREADS = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-p"))
+      ENGINE_PONDER = 1;
+    else if(!strcmp(argv[i], "-M") && i+1 < argc) {
+      long mb = atol(argv[++i]);
+      if(mb < (long) TreeMemoryMin()) {
+        fprintf(stderr, "Tree budget (-M) should be at least %ld MB\n",
+          (long) TreeMemoryMin());
+        return 1;
+      }
+      TREE_MEMORY = (size_t) mb;
+    }
+    else {
+      fprintf(stderr, "Usage: %s [-H <hash MB>] [-t <threads>] [-p]"
+        " [-M <tree MB>]\n", argv[0]);
+      return 1;
+    }
+  }
 
   // See if 8080 is free in shell
   // $  sudo lsof -i :8080
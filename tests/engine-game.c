@@ -21,7 +21,7 @@ k7/4np2/8/7n/8/8/PP6/R3K2R w KQ - 0 30
 */
 
 Flag ClientMakesAMove(_Game * g) {
-  int nmoves = (g->moves->len) / sizeof(_BoardMove);
+  int nmoves = g->moves->len;
   return floor (((double) nmoves)*rand()/RAND_MAX);
 }
 
@@ -71,8 +71,8 @@ int main(){
   
     if(server->board->color == WHITE) {
       //White engine plays
-      _BoardMove * move = GameEngineMove(server);
-      if(!move) {
+      Move move = GameEngineMove(server);
+      if(move == MOVE_NONE) {
         fprintf(stderr, 
           "Error : Engine couldn't evaluate a move");
         break;
@@ -84,12 +84,10 @@ int main(){
     else {
       Flag imove = ClientMakesAMove(server);
       //_BoardMove * move = &server->tree->children[imove]->move;
-      _BoardMove ClientMove;
-      memcpy(&ClientMove, (_BoardMove *) server->moves->p
-        + imove, sizeof(_BoardMove));
+      Move ClientMove = server->moves->moves[imove];
 
       //tell it to the sever engine
-      Flag success = GamePlayerMove(server, &ClientMove);
+      Flag success = GamePlayerMove(server, ClientMove);
       if(!success) {
         fprintf(stderr, 
           "Error : Engine couldn't find the move from Client");
@@ -57,7 +57,7 @@ int main(){
   //Create an engine    
   _Engine * e = EngineNew(b, b->color);
 
-  Array * moves = array_new();
+  MoveList moves;
   
   while(b->status == GAME_CONTINUE) { 
     TreeDebug(e->tree);   
@@ -68,17 +68,17 @@ int main(){
 
     //Now. Engine plays for both player
     e->mycolor = b->color; 
-    _BoardMove * m = e->engine(e);
+    Flag success = e->engine(e);
     fprintf(stdout, "\n Move Evaluation by Engine Ends"); fflush(stdout);
       
-    if(!m) {
+    if(!success) {
       fprintf(stdout, "\n Cannot find Move"); fflush(stdout);
       break;
     }
     fprintf(stdout, "\n Tree Game Move "); fflush(stdout);
 
     //move board
-    BoardNext(b, m, moves);
+    BoardNext(b, e->tree->move, &moves);
 
     BoardPrint(b); 
   }  
@@ -86,7 +86,5 @@ int main(){
   BoardStatusPrint(b);
   BoardDestroy(b);
 
-  array_free(moves);
-
   return 0;
 }
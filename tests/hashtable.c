@@ -0,0 +1,136 @@
+#include "../src/engine.h"
+
+//Build and run this test script using
+//$ make hashtable.tst && ./run
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Transposition table : store/probe round trips, packing ..
+  .. of the entry, replacement policies, eviction of the ..
+  .. older entries, and rejection of torn entries. Keys ..
+  .. "key + i * nbuckets" all fall into the same bucket.
+------------------------------------------------------------
+--------------------------------------------------------- */
+
+//Probe "key" and compare all the fields
+void HashTableAssert(_HashTable * t, uint64_t key, int depth,
+    Flag bound, int score, Move move) {
+  _HashEntry entry;
+  Flag found = HashTableProbe(t, key, &entry, NULL);
+  assert(found);
+  assert((entry.check ^ entry.data) == key);
+  assert(HASH_DEPTH(entry.data) == depth);
+  assert(HASH_BOUND(entry.data) == bound);
+  assert(HASH_SCORE(entry.data) == score);
+  assert(HASH_MOVE(entry.data) == move);
+  assert(HASH_AGE(entry.data) == t->age);
+}
+
+int main() {
+  _HashStats stats = {0};
+  _HashEntry entry;
+  _HashTable * t = HashTable(1, HASHTABLE_DEPTH);
+  assert(t && t->nbuckets == (1 << 20) /
+    (HASHTABLE_BUCKET * sizeof(_HashEntry)));
+  uint64_t key = 0x9E3779B97F4A7C15ULL, n = t->nbuckets;
+  Move move = MOVE_PACK(52, 36, MOVE_SPECIAL_NORMAL);  //e2e4
+
+  //Packing of the fields. Scores are signed 16 bit
+  int scores[] = { 0, 1, -1, 12345, -12345,
+    ENGINE_MATE, -ENGINE_MATE, ENGINE_MATE - 7, -ENGINE_MATE + 7,
+    ENGINE_INFINITY, -ENGINE_INFINITY, INT16_MAX, INT16_MIN };
+  for(size_t i=0; i<sizeof(scores)/sizeof(scores[0]); ++i) {
+    uint64_t data = HASH_DATA(move, scores[i], 255,
+      HASHTABLE_LOWER, 255);
+    assert(HASH_SCORE(data) == scores[i]);
+    assert(HASH_MOVE(data) == move && HASH_DEPTH(data) == 255);
+    assert(HASH_BOUND(data) == HASHTABLE_LOWER);
+    assert(HASH_AGE(data) == 255);
+  }
+
+  //Round trip. An empty table has no key, not even 0
+  assert(!HashTableProbe(t, key, &entry, &stats));
+  assert(!HashTableProbe(t, 0, &entry, &stats));
+  for(size_t i=0; i<sizeof(scores)/sizeof(scores[0]); ++i) {
+    HashTableStore(t, key + i, 5, HASHTABLE_EXACT, scores[i],
+      move, &stats);
+    HashTableAssert(t, key + i, 5, HASHTABLE_EXACT, scores[i], move);
+  }
+  //A new result without a move keeps the old best move
+  HashTableStore(t, key, 6, HASHTABLE_UPPER, -50, MOVE_NONE, &stats);
+  HashTableAssert(t, key, 6, HASHTABLE_UPPER, -50, move);
+  assert(stats.probes == 2 && stats.hits == 0 &&
+    stats.collisions == 0);
+
+  //HASHTABLE_DEPTH : a shallower bound doesn't replace ..
+  // .. a deeper result (of the same search) ..
+  HashTableClear(t);
+  HashTableStore(t, key, 8, HASHTABLE_LOWER, 100, move, NULL);
+  HashTableStore(t, key, 3, HASHTABLE_UPPER, -100, MOVE_NONE, NULL);
+  HashTableAssert(t, key, 8, HASHTABLE_LOWER, 100, move);
+  // .. unless it is exact ..
+  HashTableStore(t, key, 3, HASHTABLE_EXACT, 7, MOVE_NONE, NULL);
+  HashTableAssert(t, key, 3, HASHTABLE_EXACT, 7, move);
+  // .. or the deeper one is from an older search
+  HashTableStore(t, key, 8, HASHTABLE_LOWER, 100, move, NULL);
+  HashTableNewSearch(t);
+  HashTableStore(t, key, 3, HASHTABLE_UPPER, -100, MOVE_NONE, NULL);
+  HashTableAssert(t, key, 3, HASHTABLE_UPPER, -100, move);
+
+  //HASHTABLE_ALWAYS : the new result always replaces
+  t->policy = HASHTABLE_ALWAYS;
+  HashTableStore(t, key, 9, HASHTABLE_LOWER, 100, move, NULL);
+  HashTableStore(t, key, 2, HASHTABLE_UPPER, -100, MOVE_NONE, NULL);
+  HashTableAssert(t, key, 2, HASHTABLE_UPPER, -100, move);
+  t->policy = HASHTABLE_DEPTH;
+
+  //A full bucket evicts the shallowest entry
+  HashTableClear(t);
+  memset(&stats, 0, sizeof(_HashStats));
+  for(int i=0; i<HASHTABLE_BUCKET; ++i)
+    HashTableStore(t, key + i * n, 10 - i, HASHTABLE_EXACT, i,
+      move, &stats);
+  for(int i=0; i<HASHTABLE_BUCKET; ++i)
+    HashTableAssert(t, key + i * n, 10 - i, HASHTABLE_EXACT, i, move);
+  assert(stats.stores == HASHTABLE_BUCKET && !stats.collisions);
+  uint64_t shallowest = key + (HASHTABLE_BUCKET - 1) * n,
+    newkey = key + HASHTABLE_BUCKET * n;
+  HashTableStore(t, newkey, 1, HASHTABLE_LOWER, 0, move, &stats);
+  assert(stats.collisions == 1);
+  assert(!HashTableProbe(t, shallowest, &entry, NULL));
+  HashTableAssert(t, newkey, 1, HASHTABLE_LOWER, 0, move);
+
+  //Age : entries of an older search are evicted first, even ..
+  // .. if they are deeper
+  HashTableClear(t);
+  HashTableStore(t, key, 40, HASHTABLE_EXACT, 0, move, NULL);
+  HashTableNewSearch(t);
+  for(int i=1; i<HASHTABLE_BUCKET; ++i)
+    HashTableStore(t, key + i * n, 1, HASHTABLE_EXACT, 0, move, NULL);
+  HashTableStore(t, newkey, 1, HASHTABLE_EXACT, 0, move, NULL);
+  assert(!HashTableProbe(t, key, &entry, NULL));
+  for(int i=1; i<HASHTABLE_BUCKET; ++i)
+    HashTableAssert(t, key + i * n, 1, HASHTABLE_EXACT, 0, move);
+  HashTableAssert(t, newkey, 1, HASHTABLE_EXACT, 0, move);
+
+  //Torn entry : "check" of one write and "data" of another ..
+  // .. (as if two threads raced) is a miss
+  HashTableClear(t);
+  HashTableStore(t, key, 5, HASHTABLE_EXACT, 10, move, NULL);
+  _HashEntry * e = &t->entries[(key & t->mask) * HASHTABLE_BUCKET];
+  assert((e->check ^ e->data) == key);
+  e->data = HASH_DATA(move, 20, 5, HASHTABLE_EXACT, t->age);
+  assert(!HashTableProbe(t, key, &entry, NULL));
+  //.. so the key can be stored again
+  HashTableStore(t, key, 1, HASHTABLE_UPPER, 30, move, NULL);
+  HashTableAssert(t, key, 1, HASHTABLE_UPPER, 30, move);
+
+  //Stats of a thread are added to the table
+  HashTableAddStats(t, &stats);
+  assert(t->stats.stores == stats.stores &&
+    t->stats.collisions == stats.collisions);
+
+  HashTableDestroy(t);
+  fprintf(stdout, "\nHashTable : all tests passed\n");
+  return 0;
+}
@@ -26,14 +26,16 @@ Flag TreeNodePrint(_Tree * node){
   printf("\033[2J");   // Clear the screen
   printf("\033[1;1H");     //Cursor on the left top left
  
-  fprintf(stdout, "\nl%d d%d, max%d", 
-    node->level, node->depth, node->depthmax);
+  fprintf(stdout, "\nDepth %d, max%d", 
+    node->depth, node->depthmax);
   BoardPrint(&node->board);
   return 1;
 }
 
 
 int main(){
+  //A small budget, so that the trees below run out of nodes
+  TREE_MEMORY = 1;
   _Board * b = Board(NULL);
   //BoardSetFromFEN(b,NULL);
   //BoardSetFromFEN(b,"8/P7/8/8/8/8/8/k6K w - - 0 1");
@@ -57,7 +59,27 @@ int main(){
   _Tree * tree = Tree(b, TREE_MAX_DEPTH);
   //TreeEachNode(tree, TREE_MAX_DEPTH, TreeNodePrint);
   TreeEachNode(tree, TREE_MAX_DEPTH, TreeNodeCheckFlags);
+  MempoolPrintStats(TreePool);
   TreeDestroy(tree);
+  //Blocks freed, except one
+  MempoolPrintStats(TreePool);
+
+  /* Moving the root of a tree, which doesn't fit in the ..
+  .. budget. The new root should always have its moves, ..
+  .. even if it means dropping the retained roots */
+  BoardSetFromFEN(b,
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  tree = Tree(b, 3);
+  for(int i=0; i<20 && tree->board.status == GAME_CONTINUE; ++i) {
+    tree = TreeNext(tree, (Flag) (i % tree->nchildren));
+    assert(tree);
+    TreeWait();
+    assert(tree->board.status != GAME_CONTINUE || tree->nchildren);
+    TreeDebug(tree);
+  }
+  MempoolPrintStats(TreePool);
+  TreeDestroy(tree);
+  MempoolPrintStats(TreePool);
 
   //GameDestroy(b);
 
@@ -49,12 +49,13 @@ int main(){
   //GameAllMoves(g);
   BoardPrint(b);
 
-  Array moves = {.p = NULL, .len = 0, .max = 0};
+  MoveList moves;
   Flag status = BoardAllMoves(b, &moves);
   if(status == GAME_CONTINUE) {
-    _BoardMove * move = moves.p;
-    Flag nmoves = (Flag) (moves.len/sizeof(_BoardMove));
-    for(Flag i=0; i<nmoves; ++i, ++move){
+    Flag nmoves = (Flag) moves.len;
+    for(Flag i=0; i<nmoves; ++i){
+      _BoardMove m, * move = &m;
+      BoardMoveDecode(b, moves.moves[i], move);
 {
       clock_t start_time = clock();
       clock_t wait_time = 0.8*CLOCKS_PER_SEC ; //sleep time 
@@ -75,7 +76,6 @@ int main(){
       BoardUnmove(b, move);
       
     }  
-    free(moves.p);
   }
   //unsigned int status = Game(g);
   BoardStatusPrint(b);
@@ -0,0 +1,338 @@
+#include <pthread.h>
+#include "../src/move.h"
+
+//Build and run this test script using
+//$ make perft && ./perft suite
+//$ ./perft -t 4 -H 64 suite    (4 threads, 64 MB cache)
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Perft : count the leaf nodes of the (legal) move tree ..
+  .. to a fixed depth. The counts of well known positions ..
+  .. are published, so any bug in the move generation (or ..
+  .. in make/unmake) shows up as a wrong count. Refer
+    https://www.chessprogramming.org/Perft_Results
+  Usage
+    ./perft [options] suite                : assert counts of the suite
+    ./perft [options] <depth> [fen]        : count leaf nodes
+    ./perft [options] divide <depth> [fen] : count per root move
+  Options
+    -t <threads> : split the root moves across threads
+    -H <MB>      : cache the counts of (position, depth)
+  Default fen is the starting position. Nodes per second ..
+  .. (nps) are reported, so that the move generator can ..
+  .. be benchmarked before/after any optimization.
+  NOTE: Game over by 50 moves/insufficient material are ..
+  .. not considered, as perft counts only by the moves ..
+  .. rule (BoardLegalMoves() instead of BoardAllMoves()).
+------------------------------------------------------------
+--------------------------------------------------------- */
+
+typedef struct {
+  char * name, * fen;
+  int depth;
+  long nodes;
+} _PerftPosition;
+
+_PerftPosition PERFT_SUITE[] = {
+  { "start",
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    5, 4865609 },
+  { "kiwipete (castling, pins, en-passante)",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    4, 4085603 },
+  { "position 3 (en-passante exposing the king)",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    5, 674624 },
+  { "position 4 (promotions, castling through checks)",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    4, 422333 },
+  { "position 5 (promotion with capture, discovered checks)",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    4, 2103487 },
+  { "position 6",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    4, 3894594 },
+  { "en-passante capture giving check",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+    6, 1440467 },
+  { "illegal en-passante (pinned along the rank)",
+    "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+    6, 1134888 },
+  { "short castling giving check",
+    "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+    6, 661072 },
+  { "long castling giving check",
+    "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    6, 803711 },
+  { "castling rights lost by rook capture",
+    "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",
+    4, 1274206 },
+  { "castling prevented by attacks",
+    "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1",
+    4, 1720476 },
+  { "promotion out of check",
+    "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
+    6, 3821001 },
+  { "discovered check",
+    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+    5, 1004658 },
+  { "promotion giving check",
+    "4k3/1P6/8/8/8/8/K7/8 w - - 0 1",
+    6, 217342 },
+  { "under promotion giving check",
+    "8/P1k5/K7/8/8/8/8/8 w - - 0 1",
+    6, 92683 }
+};
+
+//Wall clock time in seconds
+double PerftClock() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Cache of perft counts shared by all the threads, ..
+  .. indexed by the zobrist key of the position. Each ..
+  .. entry is two 64 bit words
+    data = (count << 8) | depth,  check = key ^ data
+  .. written/read without any lock. If two threads write ..
+  .. the same entry simultaneously, words of different ..
+  .. writes may get mixed, in which case "check ^ data" ..
+  .. won't match the key and the entry is ignored. Refer
+    https://www.chessprogramming.org/Shared_Hash_Table
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef struct {
+  uint64_t check, data;
+} _PerftEntry;
+
+_PerftEntry * PERFT_HASH = NULL;
+uint64_t PERFT_HASH_MASK = 0;
+
+/* Allocate a cache of at most "mb" MB (power of 2 entries). ..
+.. The previous cache (if -H is repeated) is freed */
+void PerftHashNew(size_t mb) {
+  free(PERFT_HASH);
+  size_t n = 1;
+  while(2 * n * sizeof(_PerftEntry) <= mb << 20)
+    n *= 2;
+  PERFT_HASH = (_PerftEntry *) calloc(n, sizeof(_PerftEntry));
+  assert(PERFT_HASH);
+  PERFT_HASH_MASK = n - 1;
+}
+
+static inline long PerftHashProbe(uint64_t key, int depth) {
+  _PerftEntry * e = &PERFT_HASH[key & PERFT_HASH_MASK];
+  uint64_t check = __atomic_load_n(&e->check, __ATOMIC_RELAXED),
+    data = __atomic_load_n(&e->data, __ATOMIC_RELAXED);
+  if((check ^ data) != key || (int) (data & 0xFF) != depth)
+    return -1; //not found (or a torn entry)
+  return (long) (data >> 8);
+}
+
+static inline void PerftHashStore(uint64_t key, int depth, long nodes) {
+  _PerftEntry * e = &PERFT_HASH[key & PERFT_HASH_MASK];
+  uint64_t data = ((uint64_t) nodes << 8) | (uint64_t) depth;
+  __atomic_store_n(&e->check, key ^ data, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->data, data, __ATOMIC_RELAXED);
+}
+
+long Perft(_Board * b, int depth) {
+  if(!depth)
+    return 1;
+  long nodes;
+  //Bulk counted plies are cheaper than a cache lookup
+  if(PERFT_HASH && depth > 1 && 
+      (nodes = PerftHashProbe(b->hash, depth)) >= 0)
+    return nodes;
+
+  MoveList moves;
+  _BoardMoveInfo info;
+  BoardLegalMoves(b, &info, &moves);
+  //Bulk counting at the last ply
+  if(depth == 1)
+    return moves.len;
+
+  nodes = 0;
+  _BoardUndo undo;
+  for(int i=0; i<moves.len; ++i) {
+    BoardMakeMove(b, moves.moves[i], &undo);
+    nodes += Perft(b, depth - 1);
+    BoardUndoMove(b, moves.moves[i], &undo);
+  }
+  if(PERFT_HASH)
+    PerftHashStore(b->hash, depth, nodes);
+  return nodes;
+}
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Parallel perft. Root moves are picked one at a time by ..
+  .. each thread (from a shared atomic counter), so that ..
+  .. threads finishing early pick the remaining moves. ..
+  .. Each thread plays on its own copy of the board. 
+------------------------------------------------------------
+--------------------------------------------------------- */
+typedef struct {
+  _Board board;      //board of this thread
+  MoveList * moves;  //root moves (shared)
+  long * counts;     //count of each root move (shared)
+  int * next;        //next root move to be picked (shared)
+  int depth;
+} _PerftThread;
+
+void * PerftWorker(void * arg) {
+  _PerftThread * t = (_PerftThread *) arg;
+  _BoardUndo undo;
+  int i;
+  while((i = __atomic_fetch_add(t->next, 1, __ATOMIC_RELAXED)) <
+      t->moves->len) {
+    Move m = t->moves->moves[i];
+    BoardMakeMove(&t->board, m, &undo);
+    t->counts[i] = Perft(&t->board, t->depth - 1);
+    BoardUndoMove(&t->board, m, &undo);
+  }
+  return NULL;
+}
+
+//Perft using "nthreads" threads. Print count of each root ..
+// .. move if "divide" is set. Returns total
+long PerftRoot(_Board * b, int depth, int nthreads, Flag divide) {
+  MoveList moves;
+  _BoardMoveInfo info;
+  BoardLegalMoves(b, &info, &moves);
+  long counts[MOVELIST_MAX], nodes = 0;
+  int next = 0;
+
+  if(nthreads < 1)
+    nthreads = 1;
+  if(nthreads > moves.len)
+    nthreads = moves.len ? moves.len : 1;
+  pthread_t * threads = 
+    (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+  _PerftThread * t = 
+    (_PerftThread *) malloc(nthreads * sizeof(_PerftThread));
+  for(int i=0; i<nthreads; ++i) {
+    BoardCopy(&t[i].board, b);
+    t[i].moves = &moves;
+    t[i].counts = counts;
+    t[i].next = &next;
+    t[i].depth = depth;
+  }
+  //Calling thread works as the thread 0
+  for(int i=1; i<nthreads; ++i)
+    pthread_create(&threads[i], NULL, PerftWorker, &t[i]);
+  PerftWorker(&t[0]);
+  for(int i=1; i<nthreads; ++i)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  free(t);
+
+  for(int i=0; i<moves.len; ++i) {
+    Move m = moves.moves[i];
+    nodes += counts[i];
+    if(divide)
+      fprintf(stdout, "\n %c%d%c%d%c : %ld",
+        'a' + MOVE_FROM(m)%8, 8 - MOVE_FROM(m)/8,
+        'a' + MOVE_TO(m)%8, 8 - MOVE_TO(m)/8,
+        MOVE_IS_PROMOTION(m) ? MAPPING[MOVE_PROMOTED(m)] : ' ', 
+        counts[i]);
+  }
+  if(divide)
+    fprintf(stdout, "\n moves : %d", moves.len);
+  return nodes;
+}
+
+Flag PerftSetBoard(_Board * b, char * fen) {
+  char buffer[FEN_MAXSIZE];
+  strncpy(buffer, fen ? fen :
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    FEN_MAXSIZE - 1);
+  buffer[FEN_MAXSIZE - 1] = '\0';
+  if(!BoardSetFromFEN(b, buffer)) {
+    fprintf(stderr, "\nERROR: Invalid FEN %s\n", buffer);
+    return 0;
+  }
+  b->check = BoardIsKingAttacked(b, b->color);
+  return 1;
+}
+
+int PerftUsage(char * name) {
+  fprintf(stderr, "\nUsage: %s [-t <threads>] [-H <MB>] suite"
+    "\n       %s [-t <threads>] [-H <MB>] [divide] <depth> [fen]\n",
+    name, name);
+  return 1;
+}
+
+int main(int argc, char ** argv) {
+  _Board * b = Board(NULL);
+  char * name = argv[0];
+
+  //Options
+  int nthreads = 1;
+  for( ; argc > 2 && argv[1][0] == '-'; argc -= 2, argv += 2) {
+    int value = atoi(argv[2]);
+    if(strcmp(argv[1], "-t") && strcmp(argv[1], "-H"))
+      break;
+    if(value < 1)
+      return PerftUsage(name);
+    if(!strcmp(argv[1], "-t"))
+      nthreads = value;
+    else
+      PerftHashNew((size_t) value);
+  }
+
+  if(argc > 1 && !strcmp(argv[1], "suite")) {
+    int npositions = sizeof(PERFT_SUITE)/sizeof(PERFT_SUITE[0]),
+      nfailed = 0;
+    long total = 0;
+    double start = PerftClock();
+    for(int i=0; i<npositions; ++i) {
+      _PerftPosition * p = &PERFT_SUITE[i];
+      if(!PerftSetBoard(b, p->fen))
+        return 1;
+      double t = PerftClock();
+      long nodes = PerftRoot(b, p->depth, nthreads, 0);
+      t = PerftClock() - t;
+      total += nodes;
+      fprintf(stdout, "\n %-55s d%d %10ld %s (%.0f nps)", p->name,
+        p->depth, nodes, nodes == p->nodes ? "ok" : "FAILED",
+        nodes/(t > 0 ? t : 1e-9));
+      if(nodes != p->nodes) {
+        fprintf(stdout, " expected %ld", p->nodes);
+        ++nfailed;
+      }
+    }
+    double t = PerftClock() - start;
+    fprintf(stdout, "\n\n %d/%d passed. %ld nodes in %.3fs (%.0f nps)\n",
+      npositions - nfailed, npositions, total, t,
+      total/(t > 0 ? t : 1e-9));
+    fflush(stdout);
+    BoardDestroy(b);
+    free(PERFT_HASH);
+    assert(!nfailed);
+    return nfailed ? 1 : 0;
+  }
+
+  Flag divide = argc > 1 && !strcmp(argv[1], "divide");
+  char ** args = argv + 1 + divide;
+  int nargs = argc - 1 - divide;
+  if(nargs < 1 || atoi(args[0]) < 1)
+    return PerftUsage(name);
+  int depth = atoi(args[0]);
+  if(!PerftSetBoard(b, nargs > 1 ? args[1] : NULL))
+    return 1;
+
+  double t = PerftClock();
+  long nodes = PerftRoot(b, depth, nthreads, divide);
+  t = PerftClock() - t;
+  fprintf(stdout, "\n nodes : %ld\n time  : %.3fs (%.0f nps)\n",
+    nodes, t, nodes/(t > 0 ? t : 1e-9));
+
+  BoardDestroy(b);
+  free(PERFT_HASH);
+  return 0;
+}
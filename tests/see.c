@@ -0,0 +1,103 @@
+#include "../src/move.h"
+
+//Build and run this test script using
+//$ make see.tst && ./run
+
+/* ---------------------------------------------------------
+------------------------------------------------------------
+  Static exchange evaluation (BoardSee()) of a few hand ..
+  .. made positions, each asserted against the material ..
+  .. balance worked out by hand. Moves are in the long ..
+  .. algebraic notation (e2e4, a7b8q), and pieces are ..
+  .. valued as in PIECE_VALUE[] (P 100, N 320, B 330, ..
+  .. R 500, Q 900).
+------------------------------------------------------------
+--------------------------------------------------------- */
+
+typedef struct {
+  char * name, * fen, * move;
+  int see;
+} _SeePosition;
+
+_SeePosition SEE_SUITE[] = {
+  { "undefended pawn",
+    "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1",
+    "e1e5", 100 },
+  { "knight takes pawn, x-rays on both files",
+    "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1",
+    "d3e5", -220 },
+  { "rook takes defended pawn",
+    "4k3/8/3p4/4p3/8/8/8/K3R3 w - - 0 1",
+    "e1e5", -400 },
+  { "pawn takes defended knight",
+    "4k3/8/3p4/4n3/3P4/8/8/K7 w - - 0 1",
+    "d4e5", 220 },
+  { "x-ray recapture by the queen behind the rook",
+    "3rk3/8/8/3p4/8/8/3R4/3QK3 w - - 0 1",
+    "d2d5", 100 },
+  { "x-ray recaptures on both sides",
+    "3rk3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1",
+    "d2d5", -400 },
+  { "en-passante",
+    "4k3/8/8/3pP3/8/8/8/K7 w - d6 0 1",
+    "e5d6", 100 },
+  { "en-passante, recaptured",
+    "4k3/2p5/8/3pP3/8/8/8/K7 w - d6 0 1",
+    "e5d6", 0 },
+  { "promotion capture",
+    "1r2k3/P7/8/8/8/8/8/K7 w - - 0 1",
+    "a7b8q", 1300 },
+  { "promotion capture, recaptured by the king",
+    "1rk5/P7/8/8/8/8/8/K7 w - - 0 1",
+    "a7b8q", 400 },
+  { "king recaptures an undefended rook",
+    "8/8/3k4/3p4/8/8/3R4/6K1 w - - 0 1",
+    "d2d5", -400 },
+  { "king can't recapture a defended rook",
+    "8/8/3k4/3p4/8/8/3R4/3R2K1 w - - 0 1",
+    "d2d5", 100 },
+  { "king takes an undefended rook",
+    "4k3/8/8/3r4/4K3/8/8/8 w - - 0 1",
+    "e4d5", 500 }
+};
+
+//Find the legal move "str" (like e2e4 or a7b8q)
+Move SeeFindMove(_Board * b, char * str) {
+  MoveList moves;
+  _BoardMoveInfo info;
+  BoardLegalMoves(b, &info, &moves);
+  Square from = (Square) ((str[0] - 'a') + 8 * ('8' - str[1])),
+    to = (Square) ((str[2] - 'a') + 8 * ('8' - str[3]));
+  for(int i=0; i<moves.len; ++i) {
+    Move m = moves.moves[i];
+    if(MOVE_FROM(m) != from || MOVE_TO(m) != to)
+      continue;
+    if(!MOVE_IS_PROMOTION(m) ||
+        (str[4] == 'q' && MOVE_PROMOTED(m) >> 1 == BQUEEN >> 1))
+      return m;
+  }
+  return MOVE_NONE;
+}
+
+int main() {
+  _Board * b = Board(NULL);
+  char buffer[FEN_MAXSIZE];
+  int npositions = sizeof(SEE_SUITE)/sizeof(SEE_SUITE[0]);
+  for(int i=0; i<npositions; ++i) {
+    _SeePosition * p = &SEE_SUITE[i];
+    strncpy(buffer, p->fen, FEN_MAXSIZE - 1);
+    buffer[FEN_MAXSIZE - 1] = '\0';
+    Flag succ = BoardSetFromFEN(b, buffer);
+    assert(succ);
+    b->check = BoardIsKingAttacked(b, b->color);
+    Move m = SeeFindMove(b, p->move);
+    assert(m != MOVE_NONE);
+    int see = BoardSee(b, m);
+    fprintf(stdout, "\n %-45s %-5s %6d %s", p->name, p->move, see,
+      see == p->see ? "ok" : "FAILED");
+    assert(see == p->see);
+  }
+  fprintf(stdout, "\n");
+  BoardDestroy(b);
+  return 0;
+}
@@ -63,6 +63,8 @@ int main(){
   TreeEachNode(tree, 5, TreeNodeExpand);
 
   tree = TreeNext(tree, 0);
+  //wait for the background expansion of the new root
+  TreeWait();
 
   //Debug
   TreeEachNode(tree, 5, TreeNodeCheckFlags);
@@ -70,6 +72,32 @@ int main(){
 
   TreeDestroy(tree);
 
+  /* Undo. 6 pairs of moves, then 12 undos. The first ..
+  .. TREE_HISTORY undos re-root on the retained roots (no ..
+  .. rebuild). Later ones rebuild the tree */
+  _Board boards[12];
+  _Tree * roots[12];
+  BoardSetFromFEN(b,
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  tree = Tree(b, TREE_MIN_DEPTH);
+  for(int i=0; i<12; ++i) {
+    BoardCopy(&boards[i], &tree->board);
+    roots[i] = tree;
+    tree = TreeNext(tree, (Flag) (i % tree->nchildren));
+    assert(tree);
+  }
+  for(int i=11; i>=0; --i) {
+    tree = TreePrev(tree, &boards[i]);
+    assert(tree && tree->board.hash == boards[i].hash);
+    if(11 - i < TREE_HISTORY)
+      assert(tree == roots[i]);
+    TreeDebug(tree);
+  }
+  TreeDestroy(tree);
+  //Every node is back in the pool
+  TreeWait();
+  assert(!TreePool->nused);
+
   //GameDestroy(b);
 
   return 0;